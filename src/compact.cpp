@@ -0,0 +1,176 @@
+/*
+Copyright (c) 2017, Robert Krook
+Copyright (c) 2017, Erik Almblad
+Copyright (c) 2017, Hawre Aziz
+Copyright (c) 2017, Alexander Branzell
+Copyright (c) 2017, Mattias Eriksson
+Copyright (c) 2017, Carl Hjerpe
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the Chalmers University of Technology nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "compact.h"
+#include "map.h"
+#include "crossing.h"
+
+using namespace std;
+
+CompactPolygons::CompactPolygons()
+{
+}
+
+void CompactPolygons::writeDelta(long long delta)
+{
+    uint64_t v = ((uint64_t)delta << 1) ^ (uint64_t)(delta >> 63);
+    while(v >= 0x80){
+        arena.push_back((unsigned char)(v | 0x80));
+        v >>= 7;
+    }
+    arena.push_back((unsigned char)v);
+}
+
+/*
+  Encodes the polygons after the ones already stored. Only numOfNodes
+  vertices are used, like Map::isPosInPoly does.
+*/
+void CompactPolygons::append(vector<Polygon> &polygons)
+{
+    for(int p = 0; p < polygons.size(); p++){
+        Polygon &poly = polygons[p];
+        struct Header header;
+        header.offset = arena.size();
+        header.count = max(0, min(poly.numOfNodes, (int)poly.nodes.size()));
+        header.allowedInside = poly.allowedInside;
+        header.firstX = 0; header.firstY = 0;
+        header.minX = INT_MAX; header.minY = INT_MAX;
+        header.maxX = INT_MIN; header.maxY = INT_MIN;
+        for(int i = 0; i < header.count; i++){
+            Node &node = poly.nodes[i];
+            if(i == 0){
+                header.firstX = node.x;
+                header.firstY = node.y;
+            }else{
+                writeDelta((long long)node.x - poly.nodes[i-1].x);
+                writeDelta((long long)node.y - poly.nodes[i-1].y);
+            }
+            header.minX = min(header.minX, node.x); header.maxX = max(header.maxX, node.x);
+            header.minY = min(header.minY, node.y); header.maxY = max(header.maxY, node.y);
+        }
+        polys.push_back(header);
+    }
+    arena.shrink_to_fit();
+    polys.shrink_to_fit();
+}
+
+/*
+  Same verdict as Map::isPosInPoly on the polygon this one was encoded
+  from. The edges are visited in a different order, first to last and then
+  the closing edge, which doesn't change the parity.
+*/
+bool CompactPolygons::isPosInPoly(int p, int x, int y)
+{
+    Header &header = polys[p];
+    if(header.count == 0 || x < header.minX || x > header.maxX || y < header.minY || y > header.maxY){
+        return false;
+    }
+    const unsigned char *in = arena.data() + header.offset;
+    bool c = false;
+    int prevX = header.firstX, prevY = header.firstY;
+    if(prevX == x && prevY == y){
+        return true;
+    }
+    for(int i = 1; i < header.count; i++){
+        int curX = (int)(prevX + readDelta(in));
+        int curY = (int)(prevY + readDelta(in));
+        if(curX == x && curY == y){
+            return true;
+        }
+        if(crossesCompat(curX, curY, prevX, prevY, x, y)){
+            c = !c;
+        }
+        prevX = curX;
+        prevY = curY;
+    }
+    // closing edge from the last vertex back to the first
+    int curX = header.firstX, curY = header.firstY;
+    if(crossesCompat(curX, curY, prevX, prevY, x, y)){
+        c = !c;
+    }
+    return c;
+}
+
+/*
+  Expands a polygon back into poly, vertex ids are its indices. The
+  attributes of poly are left as they are.
+*/
+void CompactPolygons::decode(int p, Polygon &poly)
+{
+    Header &header = polys[p];
+    const unsigned char *in = arena.data() + header.offset;
+    poly.allowedInside = header.allowedInside;
+    poly.numOfNodes = header.count;
+    poly.nodes.resize(header.count);
+    int x = header.firstX, y = header.firstY;
+    for(int i = 0; i < header.count; i++){
+        if(i > 0){
+            x = (int)(x + readDelta(in));
+            y = (int)(y + readDelta(in));
+        }
+        poly.nodes[i].id = i;
+        poly.nodes[i].x = x;
+        poly.nodes[i].y = y;
+    }
+}
+
+bool CompactPolygons::isForbidden(int x, int y)
+{
+    for(int p = 0; p < polys.size(); p++){
+        if(isPosInPoly(p, x, y) != polys[p].allowedInside){
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+  Bounding box of a polygon, false if it has no vertices.
+*/
+bool CompactPolygons::getBounds(int p, int &minX, int &minY, int &maxX, int &maxY)
+{
+    Header &header = polys[p];
+    minX = header.minX; minY = header.minY;
+    maxX = header.maxX; maxY = header.maxY;
+    return header.count > 0;
+}
+
+size_t CompactPolygons::bytes()
+{
+    return polys.capacity() * sizeof(Header) + arena.capacity();
+}
+
+void CompactPolygons::clear()
+{
+    polys.clear();
+    arena.clear();
+}
@@ -0,0 +1,93 @@
+/*
+Copyright (c) 2017, Robert Krook
+Copyright (c) 2017, Erik Almblad
+Copyright (c) 2017, Hawre Aziz
+Copyright (c) 2017, Alexander Branzell
+Copyright (c) 2017, Mattias Eriksson
+Copyright (c) 2017, Carl Hjerpe
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the Chalmers University of Technology nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef COMPACT_H
+#define COMPACT_H
+
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+using namespace std;
+
+struct Polygon;
+
+/*
+  Polygons packed into one byte arena. Every polygon keeps its first
+  vertex and bounding box, the following vertices are stored as zigzag
+  varint deltas from the vertex before, so vertices a few units apart take
+  two bytes instead of a 12 byte Node. The deltas are decoded one edge at a
+  time inside the crossing test, a polygon is never expanded.
+*/
+class CompactPolygons{
+    public:
+        CompactPolygons();
+        void append(vector<Polygon> &polygons);
+        bool isPosInPoly(int p, int x, int y);
+        void decode(int p, Polygon &poly);
+        bool isForbidden(int x, int y);
+        bool allowedInside(int p) { return polys[p].allowedInside; }
+        bool getBounds(int p, int &minX, int &minY, int &maxX, int &maxY);
+        int size() { return polys.size(); }
+        size_t bytes();
+        void clear();
+
+    private:
+        struct Header
+        {
+            uint32_t offset;
+            int32_t count;
+            int32_t firstX, firstY;
+            int32_t minX, minY, maxX, maxY;
+            bool allowedInside;
+        };
+        vector<Header> polys;
+        vector<unsigned char> arena;
+        void writeDelta(long long delta);
+        static long long readDelta(const unsigned char *&p)
+        {
+            uint64_t b = *p++;
+            if(!(b & 0x80)){
+                return (long long)(b >> 1) ^ -(long long)(b & 1);
+            }
+            uint64_t v = b & 0x7f;
+            int shift = 7;
+            do{
+                b = *p++;
+                v |= (b & 0x7f) << shift;
+                shift += 7;
+            }while(b & 0x80);
+            return (long long)(v >> 1) ^ -(long long)(v & 1);
+        }
+};
+
+#endif
@@ -0,0 +1,138 @@
+/*
+Copyright (c) 2017, Robert Krook
+Copyright (c) 2017, Erik Almblad
+Copyright (c) 2017, Hawre Aziz
+Copyright (c) 2017, Alexander Branzell
+Copyright (c) 2017, Mattias Eriksson
+Copyright (c) 2017, Carl Hjerpe
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the Chalmers University of Technology nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef CROSSING_H
+#define CROSSING_H
+
+#include <algorithm>
+
+// The 64 bit predicates below are exact as long as every coordinate is
+// within +-CROSSING_MAX_COORD, differences then stay below 2^31 and
+// products below 2^62
+#define CROSSING_MAX_COORD  (1 << 30)
+
+#define CROSSING_OUTSIDE    0
+#define CROSSING_INSIDE     1
+#define CROSSING_BOUNDARY   2
+
+/*
+  Kernels for the crossing (even-odd) test against the ray from (x,y)
+  towards +x, for one edge from (prevX,prevY) to (curX,curY). An edge
+  takes part if it straddles y, with the lower end included and the upper
+  end excluded.
+*/
+
+/*
+  The test as Map::isPosInPoly first wrote it, with a truncating int
+  division. Kept as the baseline for benchmarks and tests, the products
+  overflow for coordinate differences above about 46000.
+*/
+inline bool crossesDivision(int curX, int curY, int prevX, int prevY, int x, int y)
+{
+    return ((curY > y) != (prevY > y)) &&
+           (x < (prevX - curX) * (y - curY) / (prevY - curY) + curX);
+}
+
+/*
+  Compatibility mode for an edge given relative to cur: k = x - curX,
+  n = dx * (y - curY) and dy, with the signs of dx and dy arranged so that
+  dy > 0. The old test toggles when x < curX + trunc(n / dy), that is
+      n >= 0:  k < floor(n / dy)  <=>  k * dy <= n - dy
+      n <  0:  k < ceil(n / dy)   <=>  k * dy <  n
+  which folds into k * dy < n - (n >= 0 ? dy - 1 : 0). Branch free, so
+  loops over many edges vectorize.
+*/
+inline bool crossesCompatRelative(long long k, long long n, long long dy)
+{
+    return k * dy < n - (n >= 0 ? dy - 1 : 0);
+}
+
+/*
+  Compatibility mode: the same verdicts as crossesDivision wherever its int
+  arithmetic doesn't overflow, without dividing.
+*/
+inline bool crossesCompat(int curX, int curY, int prevX, int prevY, int x, int y)
+{
+    if((curY > y) == (prevY > y)){
+        return false;
+    }
+    long long dx = (long long)prevX - curX;
+    long long dy = (long long)prevY - curY;
+    if(dy < 0){
+        dx = -dx;
+        dy = -dy;
+    }
+    return crossesCompatRelative((long long)x - curX, dx * ((long long)y - curY), dy);
+}
+
+/*
+  Exact mode: x is compared with the exact intersection instead of the
+  truncated one, that is the sign of the cross product of the edge and the
+  vector from cur to (x,y).
+*/
+inline bool crossesExact(int curX, int curY, int prevX, int prevY, int x, int y)
+{
+    if((curY > y) == (prevY > y)){
+        return false;
+    }
+    long long dx = (long long)prevX - curX;
+    long long dy = (long long)prevY - curY;
+    if(dy < 0){
+        dx = -dx;
+        dy = -dy;
+    }
+    return ((long long)x - curX) * dy < dx * ((long long)y - curY);
+}
+
+/*
+  Whether (x,y) lies on the closed segment between the two points: the
+  cross product is zero and the point is within the box of the segment.
+*/
+inline bool onSegment(int ax, int ay, int bx, int by, int x, int y)
+{
+    long long cross = ((long long)bx - ax) * ((long long)y - ay) -
+                      ((long long)by - ay) * ((long long)x - ax);
+    return cross == 0 &&
+           x >= std::min(ax, bx) && x <= std::max(ax, bx) &&
+           y >= std::min(ay, by) && y <= std::max(ay, by);
+}
+
+/*
+  x of the intersection of a straddling edge with row y, truncated toward
+  zero like the compatibility mode: positions left of it are crossed.
+*/
+inline long long truncatedCrossingX(int curX, int curY, int prevX, int prevY, int y)
+{
+    return curX + ((long long)prevX - curX) * ((long long)y - curY) / ((long long)prevY - curY);
+}
+
+#endif
@@ -0,0 +1,166 @@
+/*
+Copyright (c) 2017, Robert Krook
+Copyright (c) 2017, Erik Almblad
+Copyright (c) 2017, Hawre Aziz
+Copyright (c) 2017, Alexander Branzell
+Copyright (c) 2017, Mattias Eriksson
+Copyright (c) 2017, Carl Hjerpe
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the Chalmers University of Technology nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "engine.h"
+
+using namespace std;
+
+void MarkingIndex::build(Map *map)
+{
+    markings.clear();
+    for(int i = 0; i < map->markings.size(); i++){
+        markings.insert(make_pair(map->markings[i].id, map->markings[i]));
+    }
+}
+
+void IndexedEngine::build()
+{
+    markings.build(map);
+    boxes.clear();
+    allowedInside.clear();
+    cells.clear();
+    cellsX = cellsY = 0;
+    minX = minY = 0;
+    cellSize = 1;
+
+    BBox all;
+    all.empty = true;
+    all.minX = all.minY = all.maxX = all.maxY = 0;
+    Polygon scratch;
+    for(int p = 0; p < map->numOfPolygons(); p++){
+        Polygon &poly = map->polygonAt(p, scratch);
+        BBox box = boundingBox(poly);
+        boxes.push_back(box);
+        allowedInside.push_back(poly.allowedInside);
+        if(box.empty){
+            continue;
+        }
+        if(all.empty){
+            all = box;
+        }
+        all.minX = min(all.minX, box.minX); all.maxX = max(all.maxX, box.maxX);
+        all.minY = min(all.minY, box.minY); all.maxY = max(all.maxY, box.maxY);
+    }
+    // outside every box no polygon contains the position
+    outsideForbidden = false;
+    for(int p = 0; p < allowedInside.size(); p++){
+        outsideForbidden = outsideForbidden || allowedInside[p];
+    }
+    if(all.empty){
+        return;
+    }
+
+    minX = all.minX;
+    minY = all.minY;
+    long long span = max((long long)all.maxX - all.minX, (long long)all.maxY - all.minY) + 1;
+    cellSize = (int)max(1LL, (span + INDEX_GRID_CELLS - 1) / INDEX_GRID_CELLS);
+    cellsX = ((long long)all.maxX - minX) / cellSize + 1;
+    cellsY = ((long long)all.maxY - minY) / cellSize + 1;
+    cells.resize(cellsX * cellsY);
+
+    for(int cy = 0; cy < cellsY; cy++){
+        for(int cx = 0; cx < cellsX; cx++){
+            Cell &cell = cells[cy * cellsX + cx];
+            long long x0 = minX + (long long)cx * cellSize, x1 = x0 + cellSize - 1;
+            long long y0 = minY + (long long)cy * cellSize, y1 = y0 + cellSize - 1;
+            cell.baseForbidden = false;
+            for(int p = 0; p < boxes.size(); p++){
+                BBox &box = boxes[p];
+                if(!box.empty && box.minX <= x1 && box.maxX >= x0 && box.minY <= y1 && box.maxY >= y0){
+                    cell.polygons.push_back(p);
+                }else if(allowedInside[p]){
+                    cell.baseForbidden = true;
+                }
+            }
+        }
+    }
+}
+
+void SimdEngine::build()
+{
+    markings.build(map);
+    polys.clear();
+    curX.clear(); curY.clear(); prevY.clear(); dxSigned.clear(); dyAbs.clear();
+
+    Polygon scratch;
+    for(int p = 0; p < map->numOfPolygons(); p++){
+        Polygon &poly = map->polygonAt(p, scratch);
+        PolyRange range;
+        range.first = curX.size();
+        range.count = max(poly.numOfNodes, 0);
+        range.allowedInside = poly.allowedInside;
+        range.box = boundingBox(poly);
+        for(int i = 0, j = poly.numOfNodes-1; i < poly.numOfNodes; j = i++){
+            Node &prevNode = poly.nodes[j];
+            Node &curNode = poly.nodes[i];
+            long long dx = (long long)prevNode.x - curNode.x;
+            long long dy = (long long)prevNode.y - curNode.y;
+            curX.push_back(curNode.x);
+            curY.push_back(curNode.y);
+            prevY.push_back(prevNode.y);
+            dxSigned.push_back(dy < 0 ? -dx : dx);
+            dyAbs.push_back(dy < 0 ? -dy : dy);
+        }
+        polys.push_back(range);
+    }
+}
+
+// build the edge loop for several x86 levels and pick one at run time
+#ifdef MAPSERVER_TARGET_CLONES
+#define SIMD_CLONES __attribute__((target_clones("avx2", "sse4.2", "default")))
+#else
+#define SIMD_CLONES
+#endif
+
+SIMD_CLONES
+static bool crossingLoop(const int *cx, const int *cy, const int *py, const long long *dx, const long long *dy,
+                         int count, int x, int y)
+{
+    int crossings = 0, hits = 0;
+    for(int i = 0; i < count; i++){
+        int straddles = (cy[i] > y) != (py[i] > y);
+        long long n = dx[i] * ((long long)y - cy[i]);
+        crossings ^= straddles & crossesCompatRelative((long long)x - cx[i], n, dy[i]);
+        hits |= (cx[i] == x) & (cy[i] == y);
+    }
+    return hits | crossings;
+}
+
+/*
+  Same verdict as Map::isPosInPoly, the compatibility mode of crossing.h
+  on edges whose deltas are precomputed.
+*/
+bool SimdEngine::simdPosInPoly(int first, int count, int x, int y)
+{
+    return crossingLoop(&curX[first], &curY[first], &prevY[first], &dxSigned[first], &dyAbs[first],
+                        count, x, y);
+}
@@ -0,0 +1,251 @@
+/*
+Copyright (c) 2017, Robert Krook
+Copyright (c) 2017, Erik Almblad
+Copyright (c) 2017, Hawre Aziz
+Copyright (c) 2017, Alexander Branzell
+Copyright (c) 2017, Mattias Eriksson
+Copyright (c) 2017, Carl Hjerpe
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the Chalmers University of Technology nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef ENGINE_H
+#define ENGINE_H
+
+#include <unordered_map>
+#include "map.h"
+#include "raster.h"
+
+#define ENGINE_LINEAR   "linear"
+#define ENGINE_INDEXED  "indexed"
+#define ENGINE_RASTER   "raster"
+#define ENGINE_SIMD     "simd"
+#define ENGINE_COMPACT  "compact"
+
+#define INDEX_GRID_CELLS 64
+
+using namespace std;
+
+/*
+  Query engines answer the same three questions as Map: is a position
+  forbidden, the same for a whole batch of positions, and where is a
+  marking. They are used as template parameters so the hot loops are
+  compiled once per engine, without virtual calls. The base class adds the
+  batch query on top of the derived isForbidden.
+*/
+template<class Derived>
+class QueryEngine{
+    public:
+        void isForbiddenBatch(const int *xs, const int *ys, int n, unsigned char *out)
+        {
+            Derived *self = static_cast<Derived *>(this);
+            for(int i = 0; i < n; i++){
+                out[i] = self->isForbidden(xs[i], ys[i]);
+            }
+        }
+};
+
+/*
+  Marking id to position, first marking wins just like Map::getMarkingPos.
+*/
+class MarkingIndex{
+    public:
+        void build(Map *map);
+        void getMarkingPos(int id, int &x, int &y)
+        {
+            unordered_map<int, Marking>::iterator it = markings.find(id);
+            if(it == markings.end()){
+                x = -1;
+                y = -1;
+                return;
+            }
+            x = it->second.x;
+            y = it->second.y;
+        }
+
+    private:
+        unordered_map<int, Marking> markings;
+};
+
+/*
+  The reference: Map itself.
+*/
+class LinearEngine : public QueryEngine<LinearEngine>{
+    public:
+        LinearEngine(Map *map) { this->map = map; }
+        void build() {}
+        static const char *name() { return ENGINE_LINEAR; }
+        bool isForbidden(int x, int y) { return map->isForbidden(x, y); }
+        void getMarkingPos(int id, int &x, int &y) { map->getMarkingPos(id, x, y); }
+
+    private:
+        Map *map;
+};
+
+/*
+  Uniform grid over the map, every cell lists the polygons whose bounding
+  box overlaps it. All other polygons can only make the position forbidden
+  by being allowed inside, that part is precomputed per cell.
+*/
+class IndexedEngine : public QueryEngine<IndexedEngine>{
+    public:
+        IndexedEngine(Map *map) { this->map = map; }
+        void build();
+        static const char *name() { return ENGINE_INDEXED; }
+        bool isForbidden(int x, int y)
+        {
+            if(x < minX || y < minY){
+                return outsideForbidden;
+            }
+            long long cx = ((long long)x - minX) / cellSize;
+            long long cy = ((long long)y - minY) / cellSize;
+            if(cx >= cellsX || cy >= cellsY){
+                return outsideForbidden;
+            }
+            Cell &cell = cells[cy * cellsX + cx];
+            if(cell.baseForbidden){
+                return true;
+            }
+            for(int i = 0; i < cell.polygons.size(); i++){
+                int p = cell.polygons[i];
+                bool inside = boxes[p].contains(x, y) && map->isPosInPolygonAt(p, x, y);
+                if(inside != allowedInside[p]){
+                    return true;
+                }
+            }
+            return false;
+        }
+        void getMarkingPos(int id, int &x, int &y) { markings.getMarkingPos(id, x, y); }
+
+    private:
+        struct Cell
+        {
+            bool baseForbidden;
+            vector<int> polygons;
+        };
+        Map *map;
+        MarkingIndex markings;
+        vector<BBox> boxes;
+        vector<bool> allowedInside;
+        vector<Cell> cells;
+        int minX, minY, cellSize, cellsX, cellsY;
+        bool outsideForbidden;
+};
+
+/*
+  Looks the answer up in a ForbiddenRaster, either its own or one that is
+  already built for region queries. Maps too big for the raster are
+  answered by the raster's own fall back to Map.
+*/
+class RasterEngine : public QueryEngine<RasterEngine>{
+    public:
+        RasterEngine(Map *map) : own(map, RASTER_MAX_CELLS) { this->map = map; raster = &own; }
+        RasterEngine(Map *map, ForbiddenRaster *shared) : own(map, 0) { this->map = map; raster = shared; }
+        void build()
+        {
+            if(!raster->isBuilt()){
+                raster->build();
+            }
+            markings.build(map);
+        }
+        static const char *name() { return ENGINE_RASTER; }
+        bool isForbidden(int x, int y) { return raster->isForbidden(x, y); }
+        void getMarkingPos(int id, int &x, int &y) { markings.getMarkingPos(id, x, y); }
+
+    private:
+        Map *map;
+        ForbiddenRaster own;
+        ForbiddenRaster *raster;
+        MarkingIndex markings;
+};
+
+/*
+  All edges of all polygons in flat arrays (structure of arrays), so that
+  the crossing test over the edges of a polygon is one branch free loop the
+  compiler can vectorize. Uses the division free compatibility mode of
+  crossing.h, coordinates have to stay within +-CROSSING_MAX_COORD.
+*/
+class SimdEngine : public QueryEngine<SimdEngine>{
+    public:
+        SimdEngine(Map *map) { this->map = map; }
+        void build();
+        static const char *name() { return ENGINE_SIMD; }
+        bool isForbidden(int x, int y)
+        {
+            for(int p = 0; p < polys.size(); p++){
+                PolyRange &poly = polys[p];
+                bool inside = poly.box.contains(x, y) &&
+                              simdPosInPoly(poly.first, poly.count, x, y);
+                if(inside != poly.allowedInside){
+                    return true;
+                }
+            }
+            return false;
+        }
+        bool simdPosInPoly(int first, int count, int x, int y);
+        void getMarkingPos(int id, int &x, int &y) { markings.getMarkingPos(id, x, y); }
+
+    private:
+        struct PolyRange
+        {
+            int first, count;
+            bool allowedInside;
+            BBox box;
+        };
+        Map *map;
+        MarkingIndex markings;
+        vector<PolyRange> polys;
+        // per edge from prevNode to curNode: curNode, prevNode.y and the
+        // edge deltas with the sign of dy moved over to dx. The deltas
+        // reach 2^31 at +-CROSSING_MAX_COORD, so they take 64 bits
+        vector<int> curX, curY, prevY;
+        vector<long long> dxSigned, dyAbs;
+};
+
+/*
+  Compacts the map (see Map::compact) and answers from its compact store,
+  the vertices are decoded while the edges are tested. Nothing keeps a
+  second copy of the polygons, everything else built from the map reads
+  the same store through Map::polygonAt.
+*/
+class CompactEngine : public QueryEngine<CompactEngine>{
+    public:
+        CompactEngine(Map *map) { this->map = map; }
+        void build()
+        {
+            markings.build(map);
+            map->compact();
+        }
+        static const char *name() { return ENGINE_COMPACT; }
+        bool isForbidden(int x, int y) { return map->compacted.isForbidden(x, y); }
+        void getMarkingPos(int id, int &x, int &y) { markings.getMarkingPos(id, x, y); }
+        size_t bytes() { return map->compacted.bytes(); }
+
+    private:
+        Map *map;
+        MarkingIndex markings;
+};
+
+
+#endif
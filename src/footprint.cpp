@@ -0,0 +1,369 @@
+/*
+Copyright (c) 2017, Robert Krook
+Copyright (c) 2017, Erik Almblad
+Copyright (c) 2017, Hawre Aziz
+Copyright (c) 2017, Alexander Branzell
+Copyright (c) 2017, Mattias Eriksson
+Copyright (c) 2017, Carl Hjerpe
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the Chalmers University of Technology nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <math.h>
+#include <algorithm>
+#include "footprint.h"
+
+using namespace std;
+
+FootprintZones::FootprintZones(Map *map)
+{
+    this->map = map;
+    builtRevision = NOT_BUILT;
+}
+
+/*
+  How far the footprint reaches in the direction of the unit vector (nx,ny).
+*/
+static double support(Footprint *footprint, double nx, double ny)
+{
+    if(footprint->circle){
+        return footprint->radius;
+    }
+    return footprint->halfWidth * fabs(nx) + footprint->halfHeight * fabs(ny);
+}
+
+static double signedArea(vector<Node> &nodes)
+{
+    double area = 0;
+    for(int i = 0, j = nodes.size()-1; i < nodes.size(); j = i++){
+        area += (double)nodes[j].x * nodes[i].y - (double)nodes[i].x * nodes[j].y;
+    }
+    return area / 2;
+}
+
+/*
+  The polygon nodes without repeated neighbours and without a closing node
+  equal to the first one.
+*/
+static void distinctNodes(Polygon *poly, vector<Node> &src)
+{
+    src.clear();
+    for(int i = 0; i < poly->numOfNodes; i++){
+        Node &node = poly->nodes[i];
+        if(src.empty() || src.back().x != node.x || src.back().y != node.y){
+            src.push_back(node);
+        }
+    }
+    while(src.size() > 1 && src.front().x == src.back().x && src.front().y == src.back().y){
+        src.pop_back();
+    }
+}
+
+static long long cross(Node &o, Node &a, Node &b)
+{
+    return ((long long)a.x - o.x) * ((long long)b.y - o.y) - ((long long)a.y - o.y) * ((long long)b.x - o.x);
+}
+
+/*
+  True if the polygon never turns both left and right. Straight angles and
+  polygons with no area count as convex.
+*/
+static bool isConvex(vector<Node> &nodes)
+{
+    int n = nodes.size();
+    bool left = false, right = false;
+    for(int i = 0; i < n; i++){
+        long long turn = cross(nodes[i], nodes[(i+1) % n], nodes[(i+2) % n]);
+        left = left || turn > 0;
+        right = right || turn < 0;
+    }
+    return !(left && right);
+}
+
+static bool lessXY(const Node &a, const Node &b)
+{
+    return a.x < b.x || (a.x == b.x && a.y < b.y);
+}
+
+/*
+  Convex hull of the points, counter clockwise (monotone chain).
+*/
+static void convexHull(vector<Node> points, vector<Node> &hull)
+{
+    sort(points.begin(), points.end(), lessXY);
+    hull.assign(2 * points.size(), Node());
+    int k = 0;
+    for(int i = 0; i < points.size(); i++){
+        while(k >= 2 && cross(hull[k-2], hull[k-1], points[i]) <= 0) k--;
+        hull[k++] = points[i];
+    }
+    for(int i = points.size() - 2, t = k + 1; i >= 0; i--){
+        while(k >= t && cross(hull[k-2], hull[k-1], points[i]) <= 0) k--;
+        hull[k++] = points[i];
+    }
+    hull.resize(k > 1 ? k - 1 : k);
+}
+
+/*
+  Corners of a convex polygon that contains the footprint padded by one unit,
+  centered at the origin. Circles get a circumscribed octagon.
+*/
+static void footprintShape(Footprint *footprint, vector<double> &sx, vector<double> &sy)
+{
+    sx.clear();
+    sy.clear();
+    if(footprint->circle){
+        double r = (footprint->radius + 1) / cos(M_PI / 8);
+        for(int k = 0; k < 8; k++){
+            sx.push_back(r * cos((k + 0.5) * M_PI / 4));
+            sy.push_back(r * sin((k + 0.5) * M_PI / 4));
+        }
+        return;
+    }
+    double w = footprint->halfWidth + 1, h = footprint->halfHeight + 1;
+    double xs[] = {-w, w, w, -w}, ys[] = {-h, -h, h, h};
+    sx.assign(xs, xs + 4);
+    sy.assign(ys, ys + 4);
+}
+
+/*
+  Clips the convex polygon src by the half-planes n_i . p <= n_i . a_i + o_i
+  of its edges a_i (Sutherland-Hodgman) and rounds the corners that are left.
+*/
+static void clipInward(vector<Node> &src, vector<double> &nx, vector<double> &ny,
+                       vector<double> &offset, vector<Node> &result)
+{
+    vector<double> px, py;
+    for(int i = 0; i < src.size(); i++){
+        px.push_back(src[i].x);
+        py.push_back(src[i].y);
+    }
+    for(int e = 0; e < src.size() && !px.empty(); e++){
+        double c = nx[e] * src[e].x + ny[e] * src[e].y + offset[e];
+        vector<double> qx, qy;
+        for(int i = 0, m = px.size(); i < m; i++){
+            int j = (i + 1) % m;
+            double di = nx[e] * px[i] + ny[e] * py[i] - c;
+            double dj = nx[e] * px[j] + ny[e] * py[j] - c;
+            if(di <= 0){
+                qx.push_back(px[i]);
+                qy.push_back(py[i]);
+            }
+            if((di < 0 && dj > 0) || (di > 0 && dj < 0)){
+                double t = di / (di - dj);
+                qx.push_back(px[i] + t * (px[j] - px[i]));
+                qy.push_back(py[i] + t * (py[j] - py[i]));
+            }
+        }
+        px.swap(qx);
+        py.swap(qy);
+    }
+
+    result.clear();
+    for(int i = 0; i < px.size(); i++){
+        struct Node node;
+        node.id = result.size();
+        node.x = (int)lround(px[i]);
+        node.y = (int)lround(py[i]);
+        if(result.empty() || result.back().x != node.x || result.back().y != node.y){
+            result.push_back(node);
+        }
+    }
+    if(result.size() < 3 || signedArea(result) == 0){
+        result.clear();
+    }
+}
+
+/*
+  Moves every edge of the polygon along its normal by the support distance
+  of the footprint. Inflated polygons get their new vertices where
+  neighbouring edges meet (conservative around corners). Deflated ones are
+  the intersection of the half-planes inside the moved edges, so edges that
+  vanish under the offset are dropped instead of leaving a loop. This is
+  only correct for convex polygons, on concave ones the new edges can cross
+  each other and the crossing test then sees holes. build uses sweepEdges
+  for those instead. Distances are padded by one unit so that rounding the
+  vertices to integers never eats into the margin.
+  Polygons with no area are copied as they are, a deflated polygon with
+  nothing left gets no nodes at all.
+*/
+void FootprintZones::offsetPoly(Polygon *poly, Footprint *footprint, bool inflate, Polygon &result)
+{
+    result.allowedInside = poly->allowedInside;
+    result.nodes.clear();
+
+    vector<Node> src;
+    distinctNodes(poly, src);
+
+    double area = signedArea(src);
+    if(src.size() < 3 || area == 0){
+        result.nodes = poly->nodes;
+        result.numOfNodes = poly->numOfNodes;
+        return;
+    }
+    // outward normal of an edge (dx,dy) is (dy,-dx) for counter clockwise
+    // polygons, flip it for clockwise ones
+    double orientation = (area > 0) ? 1 : -1;
+    double sign = inflate ? 1 : -1;
+
+    int n = src.size();
+    vector<double> nx(n), ny(n), offset(n);
+    for(int i = 0; i < n; i++){
+        Node &a = src[i];
+        Node &b = src[(i+1) % n];
+        double dx = (double)b.x - a.x, dy = (double)b.y - a.y;
+        double len = hypot(dx, dy);
+        nx[i] = orientation * dy / len;
+        ny[i] = -orientation * dx / len;
+        offset[i] = sign * (support(footprint, nx[i], ny[i]) + 1);
+    }
+
+    if(!inflate){
+        clipInward(src, nx, ny, offset, result.nodes);
+        result.numOfNodes = result.nodes.size();
+        return;
+    }
+
+    for(int k = 0; k < n; k++){
+        int prev = (k + n - 1) % n;
+        Node &v = src[k];
+        // solve n_prev . p = n_prev . v + o_prev and n_k . p = n_k . v + o_k
+        double c1 = nx[prev] * v.x + ny[prev] * v.y + offset[prev];
+        double c2 = nx[k] * v.x + ny[k] * v.y + offset[k];
+        double det = nx[prev] * ny[k] - ny[prev] * nx[k];
+        double px, py;
+        if(fabs(det) < 1e-9){
+            px = v.x + nx[k] * offset[k];
+            py = v.y + ny[k] * offset[k];
+        }else{
+            px = (c1 * ny[k] - ny[prev] * c2) / det;
+            py = (nx[prev] * c2 - c1 * nx[k]) / det;
+        }
+        struct Node node;
+        node.id = k;
+        node.x = (int)lround(px);
+        node.y = (int)lround(py);
+        result.nodes.push_back(node);
+    }
+
+    result.numOfNodes = result.nodes.size();
+}
+
+/*
+  Minkowski sum of every polygon edge with the footprint, as one forbidden
+  inside polygon per edge. Together with the polygon itself these give the
+  exact inflated (OUTSIDE) or deflated (INSIDE) zone for any polygon, since
+  a footprint overlaps the boundary exactly when its center is within the
+  footprint of some edge. Each piece has up to 16 vertices, so a query
+  against a concave polygon of n edges costs about as much as a point query
+  against n more polygons.
+*/
+void FootprintZones::sweepEdges(Polygon *poly, Footprint *footprint, vector<Polygon> &result)
+{
+    vector<Node> src;
+    distinctNodes(poly, src);
+    vector<double> sx, sy;
+    footprintShape(footprint, sx, sy);
+
+    int n = src.size();
+    for(int i = 0; i < n; i++){
+        Node &a = src[i];
+        Node &b = src[(i+1) % n];
+        vector<Node> points;
+        for(int k = 0; k < sx.size(); k++){
+            struct Node node;
+            node.id = 0;
+            node.x = (int)lround(a.x + sx[k]);
+            node.y = (int)lround(a.y + sy[k]);
+            points.push_back(node);
+            node.x = (int)lround(b.x + sx[k]);
+            node.y = (int)lround(b.y + sy[k]);
+            points.push_back(node);
+        }
+        struct Polygon piece;
+        piece.allowedInside = false;
+        convexHull(points, piece.nodes);
+        for(int k = 0; k < piece.nodes.size(); k++){
+            piece.nodes[k].id = k;
+        }
+        piece.numOfNodes = piece.nodes.size();
+        result.push_back(piece);
+    }
+}
+
+void FootprintZones::build()
+{
+    zones.clear();
+    for(int f = 0; f < map->footprints.size(); f++){
+        Footprint &footprint = map->footprints[f];
+        if(footprint.id < 0){
+            continue;
+        }
+        Zones z;
+        z.footprintId = footprint.id;
+        Polygon scratch;
+        for(int i = 0; i < map->numOfPolygons(); i++){
+            Polygon &poly = map->polygonAt(i, scratch);
+            vector<Node> src;
+            distinctNodes(&poly, src);
+            if(isConvex(src)){
+                struct Polygon offsetted;
+                offsetPoly(&poly, &footprint, !poly.allowedInside, offsetted);
+                z.polygons.push_back(offsetted);
+            }else{
+                z.polygons.push_back(poly);
+                sweepEdges(&poly, &footprint, z.polygons);
+            }
+        }
+        zones.push_back(z);
+    }
+    builtRevision = map->revision;
+}
+
+/*
+  Same rule as Map::isForbiddenPos, but against the polygons precomputed for
+  the footprint class. Returns false if the class is unknown.
+*/
+bool FootprintZones::isFootprintForbidden(int x, int y, int footprintId, bool &b)
+{
+    if(builtRevision != map->revision){
+        build();
+    }
+    for(int f = 0; f < zones.size(); f++){
+        if(zones[f].footprintId != footprintId){
+            continue;
+        }
+        vector<Polygon> &polygons = zones[f].polygons;
+        for(int i = 0; i < polygons.size(); i++){
+            if(map->isPosInPoly(&polygons[i], x, y) != polygons[i].allowedInside){
+                b = true;
+                return true;
+            }
+        }
+        b = false;
+        return true;
+    }
+    b = true;
+    return false;
+}
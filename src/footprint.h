@@ -0,0 +1,68 @@
+/*
+Copyright (c) 2017, Robert Krook
+Copyright (c) 2017, Erik Almblad
+Copyright (c) 2017, Hawre Aziz
+Copyright (c) 2017, Alexander Branzell
+Copyright (c) 2017, Mattias Eriksson
+Copyright (c) 2017, Carl Hjerpe
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the Chalmers University of Technology nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef FOOTPRINT_H
+#define FOOTPRINT_H
+
+#include "map.h"
+
+using namespace std;
+
+/*
+  Per footprint class copies of the map polygons, grown or shrunk by the
+  footprint so that a single point test against them tells if any part of
+  the robot would be in forbidden space. Forbidden inside (OUTSIDE) polygons
+  are inflated, allowed inside (INSIDE) polygons are deflated. Concave
+  polygons are kept as they are plus one forbidden polygon per edge, which
+  makes footprint queries on maps with many concave edges several times as
+  expensive as point queries.
+*/
+class FootprintZones{
+    public:
+        FootprintZones(Map *map);
+        void build();
+        bool isFootprintForbidden(int x, int y, int footprintId, bool &b);
+        void offsetPoly(Polygon *poly, Footprint *footprint, bool inflate, Polygon &result);
+        void sweepEdges(Polygon *poly, Footprint *footprint, vector<Polygon> &result);
+        unsigned long builtRevision;
+
+    private:
+        struct Zones
+        {
+            int footprintId;
+            vector<Polygon> polygons;
+        };
+        Map *map;
+        vector<Zones> zones;
+};
+
+#endif
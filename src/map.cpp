@@ -52,8 +52,9 @@ void Map::printMarking(Marking *marking)
 void Map::printMap()
 {
     cout << "\nPolygons:" << endl;
-    for(int i = 0; i < polygons.size();i++){
-        printPoly(&polygons.at(i));
+    Polygon scratch;
+    for(int i = 0; i < numOfPolygons();i++){
+        printPoly(&polygonAt(i, scratch));
     }   
     cout << "\nMarkings:" << endl;
     for(int i = 0; i < markings.size();i++){
@@ -61,20 +62,41 @@ void Map::printMap()
     }
 }
 
-void Map::createPoly(ifstream &in, Polygon &poly)
+void Map::createPoly(ifstream &in, Polygon &poly, const char *end)
 {
     string str;
     int nodeCounter = 0;
 
     while(getline(in,str)){
         cout << str << endl;
-        if(!str.compare(POLY_END)){
+        if(!str.compare(end)){
             poly.numOfNodes = nodeCounter;
             return;
         }else if(str.find(POLY_INSIDE) != string::npos){
             poly.allowedInside = true;
         }else if(str.find(POLY_OUTSIDE) != string::npos){
             poly.allowedInside = false;
+        }else if(str.find(ATTR_NO_STOP) != string::npos){
+            poly.attributes.flags |= ZONE_NO_STOP;
+        }else if(str.find(ATTR_SPEED_LIMIT) != string::npos || str.find(ATTR_ONE_WAY) != string::npos){
+            bool speedLimit = str.find(ATTR_SPEED_LIMIT) != string::npos;
+            const char *name = speedLimit ? ATTR_SPEED_LIMIT : ATTR_ONE_WAY;
+            int value;
+            try {
+                value = stoi(str.substr(str.find(name) + strlen(name)));
+            } catch(...) {
+                cout << "ERROR: TRIED PARSING A STRING TO A DIGIT" << endl;
+                struct Polygon errpoly;
+                poly = errpoly;
+                return;
+            }
+            if(speedLimit){
+                poly.attributes.flags |= ZONE_SPEED_LIMIT;
+                poly.attributes.speedLimit = value;
+            }else{
+                poly.attributes.flags |= ZONE_ONE_WAY;
+                poly.attributes.heading = value;
+            }
 		}else{                        
             str.erase(remove(str.begin(), str.end(), ' '), str.end()); // remove all white spaces
             size_t index = str.find(',');
@@ -118,6 +140,39 @@ void Map::createMarking(ifstream &in, Marking &marking)
     }    
 }
 
+void Map::createFootprint(ifstream &in, Footprint &footprint)
+{
+    string str;
+    getline(in,str);
+    str.erase(remove(str.begin(), str.end(), ' '), str.end()); // remove all white spaces
+    footprint.id = -1;
+    footprint.circle = false;
+    footprint.halfWidth = 0; footprint.halfHeight = 0; footprint.radius = 0;
+    try {
+        footprint.id = stoi(str);
+        getline(in,str);
+        str.erase(remove(str.begin(), str.end(), ' '), str.end());
+        if(!str.compare(0, strlen(FOOTPRINT_CIRCLE), FOOTPRINT_CIRCLE)){
+            footprint.circle = true;
+            footprint.radius = stoi(str.substr(strlen(FOOTPRINT_CIRCLE)));
+        }else if(!str.compare(0, strlen(FOOTPRINT_RECT), FOOTPRINT_RECT)){
+            str = str.substr(strlen(FOOTPRINT_RECT));
+            size_t index = str.find(',');
+            footprint.halfWidth = stoi(str.substr(0,index));
+            footprint.halfHeight = stoi(str.substr(index+1,str.length()-index));
+        }else{
+            footprint.id = -1;
+        }
+    } catch(...) {
+        footprint.id = -1;
+    }
+    getline(in,str);
+    if(str.compare(FOOTPRINT_END) || footprint.id < 0){
+        cerr << "Something wrong with a footprint.." << str << endl;
+        footprint.id = -1;
+    }
+}
+
 bool Map::isCommentLine(string &str)
 {
     return str[0] == COMMENT_SIGN;
@@ -137,6 +192,10 @@ void Map::getMarkingPos(int id, int &x, int &y)
     y = -1;
 }
 
+/*
+  The crossing test in compatibility mode (see crossing.h), a vertex
+  counts as inside.
+*/
 bool Map::isPosInPoly(Polygon *poly, int x, int y)
 {
     bool c = false;
@@ -152,14 +211,35 @@ bool Map::isPosInPoly(Polygon *poly, int x, int y)
             return true;
         }
 
-        if(((curNode.y > y) != (prevNode.y > y)) &&
-            (x < (prevNode.x - curNode.x) * (y - curNode.y) / (prevNode.y - curNode.y) + curNode.x)){
+        if(crossesCompat(curNode.x, curNode.y, prevNode.x, prevNode.y, x, y)){
             c = !c;
         }
     }
     return c;
 }
 
+/*
+  Exact version of isPosInPoly: CROSSING_BOUNDARY for a position on any
+  edge, otherwise CROSSING_INSIDE or CROSSING_OUTSIDE by the exact crossing
+  test. Differs from isPosInPoly only next to the edges, where the
+  truncated intersection is off by less than one.
+*/
+int Map::classifyPosInPoly(Polygon *poly, int x, int y)
+{
+    bool c = false;
+    for(int i = 0, j = poly->numOfNodes-1; i < poly->numOfNodes; j = i++){
+        Node &prevNode = poly->nodes.at(j);
+        Node &curNode = poly->nodes.at(i);
+        if(onSegment(prevNode.x, prevNode.y, curNode.x, curNode.y, x, y)){
+            return CROSSING_BOUNDARY;
+        }
+        if(crossesExact(curNode.x, curNode.y, prevNode.x, prevNode.y, x, y)){
+            c = !c;
+        }
+    }
+    return c ? CROSSING_INSIDE : CROSSING_OUTSIDE;
+}
+
 
 void Map::isForbiddenPos(int x, int y, bool &b)
 {
@@ -170,7 +250,100 @@ void Map::isForbiddenPos(int x, int y, bool &b)
             return;
         }
     }
-    b = false;
+    b = compacted.isForbidden(x, y);
+}
+
+/*
+  Same answer as isForbiddenPos but without the debug printing, used by
+  everything that has to evaluate a lot of points.
+*/
+bool Map::isForbidden(int x, int y)
+{
+    for(int i = 0; i < polygons.size(); i++){
+        if(isPosInPoly(&polygons.at(i), x, y) != polygons.at(i).allowedInside){
+            return true;
+        }
+    }
+    return compacted.isForbidden(x, y);
+}
+
+void Map::mapChanged()
+{
+    revision++;
+}
+
+/*
+  All polygons, compacted or not. Everything derived from the map walks
+  them with numOfPolygons and polygonAt, so it can be built the same way
+  before and after compact().
+*/
+int Map::numOfPolygons()
+{
+    return compacted.size() + polygons.size();
+}
+
+/*
+  The i:th polygon, compacted ones first. A compacted polygon is decoded
+  into scratch and scratch is returned, so the result is only valid until
+  scratch is used again. Not thread safe on a compacted map unless every
+  thread has a scratch of its own.
+*/
+Polygon &Map::polygonAt(int i, Polygon &scratch)
+{
+    if(i >= compacted.size()){
+        return polygons[i - compacted.size()];
+    }
+    compacted.decode(i, scratch);
+    scratch.attributes = compactedAttributes[i];
+    return scratch;
+}
+
+/*
+  isPosInPoly on the i:th polygon without decoding it.
+*/
+bool Map::isPosInPolygonAt(int i, int x, int y)
+{
+    if(i >= compacted.size()){
+        return isPosInPoly(&polygons[i - compacted.size()], x, y);
+    }
+    return compacted.isPosInPoly(i, x, y);
+}
+
+/*
+  Moves all polygons into the compact store and frees their node vectors.
+  The answers of isForbidden stay the same and polygonAt keeps the order,
+  so anything derived from the map is built the same way afterwards. Only
+  code that walks the polygons vector itself (the normalizer) sees an empty
+  map.
+*/
+void Map::compact()
+{
+    size_t before = polygons.capacity() * sizeof(Polygon);
+    for(int i = 0; i < polygons.size(); i++){
+        before += polygons[i].nodes.capacity() * sizeof(Node);
+        compactedAttributes.push_back(polygons[i].attributes);
+    }
+    compacted.append(polygons);
+    vector<Polygon>().swap(polygons);
+    compactedAttributes.shrink_to_fit();
+    cout << "Compacted polygons from " << before << " to " << compacted.bytes() << " bytes" << endl;
+}
+
+BBox boundingBox(Polygon &poly)
+{
+    BBox box;
+    box.empty = poly.numOfNodes <= 0;
+    box.minX = box.minY = box.maxX = box.maxY = 0;
+    for(int i = 0; i < poly.numOfNodes; i++){
+        Node &node = poly.nodes[i];
+        if(i == 0){
+            box.minX = box.maxX = node.x;
+            box.minY = box.maxY = node.y;
+        }
+        box.minX = min(box.minX, node.x); box.maxX = max(box.maxX, node.x);
+        box.minY = min(box.minY, node.y); box.maxY = max(box.maxY, node.y);
+    }
+    return box;
 }
 
 string Map::getexepath()
@@ -182,6 +355,7 @@ string Map::getexepath()
 
 Map::Map()
 {	
+    revision = 0;
     string executionPath = getexepath();
 
     cout << "execution path: " << executionPath << endl;
@@ -204,6 +378,14 @@ Map::Map()
 
     cout << path << endl;
 
+    load(path);
+}
+
+/*
+  Reads polygons and markings from a map file and appends them to the map.
+*/
+void Map::load(string path)
+{
     ifstream in(path);
 
     if(!in){
@@ -225,10 +407,20 @@ Map::Map()
             struct Marking marking;
             createMarking(in, marking);
             markings.push_back(marking);
+        }else if(!str.compare(ZONE_START)){
+            struct Polygon zone;
+            zone.allowedInside = true;
+            createPoly(in, zone, ZONE_END);
+            zones.push_back(zone);
+        }else if(!str.compare(FOOTPRINT_START)){
+            struct Footprint footprint;
+            createFootprint(in, footprint);
+            footprints.push_back(footprint);
         }else if(!str.empty()){
             cout << "Can't parse line: " << str << endl;
         }       
     }
+    mapChanged();
     cout << "Created map" << endl;
 }
 
@@ -31,6 +31,8 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 // Needs to be compiled with flag -std=c++11 
 
+#ifndef MAP_H
+#define MAP_H
 
 #include <iostream>
 #include <fstream>
@@ -38,7 +40,10 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <vector>
 #include <algorithm>
 #include <limits.h>
+#include <string.h>
 #include <unistd.h>
+#include "compact.h"
+#include "crossing.h"
 
 #define POLY_START      "BEGIN POLYGON"
 #define POLY_END        "END POLYGON"
@@ -46,7 +51,17 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define POLY_OUTSIDE    "OUTSIDE"
 #define MARKING_START   "BEGIN MARKING"
 #define MARKING_END     "END MARKING" 
+#define FOOTPRINT_START "BEGIN FOOTPRINT"
+#define FOOTPRINT_END   "END FOOTPRINT"
+#define FOOTPRINT_RECT  "RECT"
+#define FOOTPRINT_CIRCLE "CIRCLE"
+#define ZONE_START      "BEGIN ZONE"
+#define ZONE_END        "END ZONE"
+#define ATTR_SPEED_LIMIT "SPEED_LIMIT"
+#define ATTR_NO_STOP    "NO_STOP"
+#define ATTR_ONE_WAY    "ONE_WAY"
 #define COMMENT_SIGN    '#'
+#define NOT_BUILT       ((unsigned long)-1)
 
 using namespace std;
 
@@ -56,6 +71,31 @@ struct Marking
     int x, y;
 };
 
+// Shape of a robot, centered on the position that gets queried. Rectangles
+// are axis aligned and given by their half width and half height.
+struct Footprint
+{
+    int id;
+    bool circle;
+    int halfWidth, halfHeight;
+    int radius;
+};
+
+// Bits of ZoneAttributes::flags, ZONE_FORBIDDEN is only set by queries
+#define ZONE_FORBIDDEN      0x1
+#define ZONE_SPEED_LIMIT    0x2
+#define ZONE_NO_STOP        0x4
+#define ZONE_ONE_WAY        0x8
+
+// Typed attributes of the area inside a polygon, speedLimit and heading
+// (degrees) are only meaningful when their flag is set
+struct ZoneAttributes
+{
+    unsigned int flags = 0;
+    int speedLimit = 0;
+    int heading = 0;
+};
+
 struct Node
 {
 	int id;
@@ -67,27 +107,65 @@ struct Polygon
     bool allowedInside;
     int numOfNodes;
 	vector<Node> nodes;
+    ZoneAttributes attributes;
 };
 
+/*
+  Bounding box of a polygon. A point outside it is never inside the polygon
+  according to Map::isPosInPoly, the truncated intersection can't end up
+  outside the box.
+*/
+struct BBox
+{
+    int minX, minY, maxX, maxY;
+    bool empty;
+    bool contains(int x, int y)
+    {
+        return !empty && x >= minX && x <= maxX && y >= minY && y <= maxY;
+    }
+};
+
+BBox boundingBox(Polygon &poly);
+
 class Map{
     public:
         vector<Polygon> polygons;
         vector<Marking> markings;
+        vector<Footprint> footprints;
+        // polygons that only carry attributes, they never make a position
+        // forbidden
+        vector<Polygon> zones;
         void printPoly(Polygon *poly);
         void printMarking(Marking *marking);
         void printMap();
         void getMarkingPos(int id, int &x, int &y);
         bool isPosInPoly(Polygon *poly, int x, int y);
+        int classifyPosInPoly(Polygon *poly, int x, int y);
         void isForbiddenPos(int x, int y, bool &b);
+        bool isForbidden(int x, int y);
+        int numOfPolygons();
+        Polygon &polygonAt(int i, Polygon &scratch);
+        bool isPosInPolygonAt(int i, int x, int y);
+        void mapChanged();
+        void load(string path);
+        void compact();
         string getexepath();
         Map();        
+
+        // bumped every time polygons or markings change, anything derived
+        // from the map compares against it to know when to rebuild
+        unsigned long revision;
+
+        // polygons moved here by compact() and their attributes, they come
+        // before the ones still in polygons in polygonAt order
+        CompactPolygons compacted;
+        vector<ZoneAttributes> compactedAttributes;
         
     private:
-        void createPoly(ifstream &in, Polygon &poly);
+        void createPoly(ifstream &in, Polygon &poly, const char *end = POLY_END);
         void createMarking(ifstream &in, Marking &marking);
+        void createFootprint(ifstream &in, Footprint &footprint);
         bool isCommentLine(string &str);
 };
 
-
-
-
+#endif
@@ -0,0 +1,393 @@
+/*
+Copyright (c) 2017, Robert Krook
+Copyright (c) 2017, Erik Almblad
+Copyright (c) 2017, Hawre Aziz
+Copyright (c) 2017, Alexander Branzell
+Copyright (c) 2017, Mattias Eriksson
+Copyright (c) 2017, Carl Hjerpe
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the Chalmers University of Technology nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+#include "mapSocket.h"
+
+#define MAX_EVENTS      64
+#define READ_CHUNK      65536
+// bytes of unanswered input plus unsent output a connection may hold
+#define MAX_PENDING     (1 << 20)
+
+using namespace std;
+
+static bool setNonBlocking(int fd)
+{
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+static bool fillAddress(string path, struct sockaddr_un &addr)
+{
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if(path.size() >= sizeof(addr.sun_path)){
+        cerr << "Socket path too long: " << path << endl;
+        return false;
+    }
+    strcpy(addr.sun_path, path.c_str());
+    return true;
+}
+
+SocketServer::SocketServer(Map *map, string path)
+{
+    this->map = map;
+    this->path = path;
+    listenFd = epollFd = stopFd = -1;
+    shadow = NULL;
+    forbiddenBatch = NULL;
+    engine = NULL;
+}
+
+SocketServer::~SocketServer()
+{
+    stop();
+}
+
+bool SocketServer::start()
+{
+    struct sockaddr_un addr;
+    if(!fillAddress(path, addr)){
+        return false;
+    }
+    unlink(path.c_str());
+
+    listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(listenFd < 0 || !setNonBlocking(listenFd) ||
+       bind(listenFd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+       listen(listenFd, SOMAXCONN) < 0){
+        cerr << "Cannot listen on " << path << ": " << strerror(errno) << endl;
+        stop();
+        return false;
+    }
+
+    epollFd = epoll_create1(0);
+    stopFd = eventfd(0, EFD_NONBLOCK);
+    if(epollFd < 0 || stopFd < 0){
+        cerr << "Cannot set up epoll: " << strerror(errno) << endl;
+        stop();
+        return false;
+    }
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.ptr = NULL;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, stopFd, &ev);
+    ev.data.ptr = &listenFd;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &ev);
+
+    worker = thread(&SocketServer::run, this);
+    return true;
+}
+
+void SocketServer::stop()
+{
+    if(worker.joinable()){
+        uint64_t one = 1;
+        if(write(stopFd, &one, sizeof(one)) != sizeof(one)){
+            cerr << "Cannot wake up socket server" << endl;
+        }
+        worker.join();
+    }
+    while(!connections.empty()){
+        drop(*connections.begin());
+    }
+    if(listenFd >= 0){
+        ::close(listenFd);
+        unlink(path.c_str());
+    }
+    if(epollFd >= 0) ::close(epollFd);
+    if(stopFd >= 0) ::close(stopFd);
+    listenFd = epollFd = stopFd = -1;
+}
+
+void SocketServer::answer(SocketRequest *reqs, SocketResponse *res, int n)
+{
+    vector<int> xs, ys, index;
+    for(int i = 0; i < n; i++){
+        SocketRequest &req = reqs[i];
+        res[i].seq = req.seq;
+        res[i].status = SOCKET_STATUS_OK;
+        res[i].a = 0;
+        res[i].b = 0;
+        if(req.op == SOCKET_OP_MARKING_POS){
+            int x, y;
+            map->getMarkingPos(req.a, x, y);
+            res[i].a = x;
+            res[i].b = y;
+        }else if(req.op == SOCKET_OP_FORBIDDEN_POS){
+            xs.push_back(req.a);
+            ys.push_back(req.b);
+            index.push_back(i);
+        }else{
+            res[i].status = SOCKET_STATUS_BAD_OP;
+        }
+    }
+    if(index.empty()){
+        return;
+    }
+
+    vector<unsigned char> forbidden(index.size());
+    if(forbiddenBatch != NULL){
+        forbiddenBatch(engine, xs.data(), ys.data(), index.size(), forbidden.data());
+    }else{
+        for(int i = 0; i < index.size(); i++){
+            forbidden[i] = map->isForbidden(xs[i], ys[i]);
+        }
+    }
+    for(int i = 0; i < index.size(); i++){
+        res[index[i]].a = forbidden[i];
+        if(shadow != NULL){
+            shadow->submit(xs[i], ys[i], forbidden[i]);
+        }
+    }
+}
+
+void SocketServer::accept()
+{
+    while(true){
+        int fd = ::accept(listenFd, NULL, NULL);
+        if(fd < 0){
+            return;
+        }
+        setNonBlocking(fd);
+        Connection *conn = new Connection;
+        conn->fd = fd;
+        conn->eof = false;
+        connections.insert(conn);
+        struct epoll_event ev;
+        ev.events = EPOLLIN | EPOLLRDHUP;
+        ev.data.ptr = conn;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev);
+    }
+}
+
+/*
+  Writes as much of the pending output as the socket takes, and only asks
+  epoll for writability while something is left over. Reading is paused
+  while the output is over MAX_PENDING, so a client that never reads its
+  responses stops being served instead of growing the buffer.
+*/
+bool SocketServer::flush(Connection *conn)
+{
+    size_t sent = 0;
+    while(sent < conn->out.size()){
+        ssize_t n = send(conn->fd, conn->out.data() + sent, conn->out.size() - sent, MSG_NOSIGNAL);
+        if(n < 0){
+            if(errno == EAGAIN || errno == EWOULDBLOCK){
+                break;
+            }
+            return false;
+        }
+        sent += n;
+    }
+    conn->out.erase(0, sent);
+
+    struct epoll_event ev;
+    ev.events = 0;
+    if(!conn->eof && conn->out.size() < MAX_PENDING){
+        ev.events |= EPOLLIN | EPOLLRDHUP;
+    }
+    if(!conn->out.empty()){
+        ev.events |= EPOLLOUT;
+    }
+    ev.data.ptr = conn;
+    epoll_ctl(epollFd, EPOLL_CTL_MOD, conn->fd, &ev);
+    return true;
+}
+
+/*
+  Reads what is available up to MAX_PENDING, answers every complete request
+  in it and sends all the responses in one go. After the client has shut
+  down its side the connection is kept until the last response is sent.
+  Returns false when the connection should be closed.
+*/
+bool SocketServer::serve(Connection *conn)
+{
+    char buf[READ_CHUNK];
+    while(!conn->eof && conn->in.size() + conn->out.size() < MAX_PENDING){
+        ssize_t n = recv(conn->fd, buf, sizeof(buf), 0);
+        if(n > 0){
+            conn->in.append(buf, n);
+            continue;
+        }
+        if(n == 0){
+            conn->eof = true;
+        }else if(errno != EAGAIN && errno != EWOULDBLOCK){
+            return false;
+        }
+        break;
+    }
+
+    size_t count = conn->in.size() / sizeof(SocketRequest);
+    if(count > 0){
+        vector<SocketRequest> reqs(count);
+        vector<SocketResponse> res(count);
+        memcpy(reqs.data(), conn->in.data(), count * sizeof(SocketRequest));
+        answer(reqs.data(), res.data(), count);
+        conn->out.append((const char *)res.data(), count * sizeof(SocketResponse));
+        conn->in.erase(0, count * sizeof(SocketRequest));
+    }
+    return flush(conn) && !isDone(conn);
+}
+
+/*
+  True once the client will send nothing more and has got all its answers.
+*/
+bool SocketServer::isDone(Connection *conn)
+{
+    return conn->eof && conn->out.empty();
+}
+
+void SocketServer::drop(Connection *conn)
+{
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, conn->fd, NULL);
+    ::close(conn->fd);
+    connections.erase(conn);
+    delete conn;
+}
+
+void SocketServer::run()
+{
+    struct epoll_event events[MAX_EVENTS];
+    while(true){
+        int n = epoll_wait(epollFd, events, MAX_EVENTS, -1);
+        if(n < 0 && errno != EINTR){
+            cerr << "epoll_wait failed: " << strerror(errno) << endl;
+            return;
+        }
+        for(int i = 0; i < n; i++){
+            void *ptr = events[i].data.ptr;
+            if(ptr == NULL){
+                return;
+            }
+            if(ptr == &listenFd){
+                accept();
+                continue;
+            }
+            Connection *conn = (Connection *)ptr;
+            bool keep;
+            if(events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)){
+                keep = serve(conn);
+            }else{
+                keep = flush(conn) && !isDone(conn);
+            }
+            if(!keep){
+                drop(conn);
+            }
+        }
+    }
+}
+
+SocketClient::SocketClient()
+{
+    fd = -1;
+}
+
+SocketClient::~SocketClient()
+{
+    close();
+}
+
+bool SocketClient::connect(string path)
+{
+    struct sockaddr_un addr;
+    if(!fillAddress(path, addr)){
+        return false;
+    }
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(fd < 0 || ::connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0){
+        close();
+        return false;
+    }
+    return true;
+}
+
+/*
+  Sends all requests and reads their responses at the same time, the server
+  stops reading from a client whose responses pile up unread.
+*/
+bool SocketClient::query(vector<SocketRequest> &reqs, vector<SocketResponse> &res)
+{
+    const char *out = (const char *)reqs.data();
+    size_t toSend = reqs.size() * sizeof(SocketRequest);
+    res.resize(reqs.size());
+    char *in = (char *)res.data();
+    size_t toRead = res.size() * sizeof(SocketResponse);
+
+    while(toRead > 0){
+        struct pollfd pfd;
+        pfd.fd = fd;
+        pfd.events = POLLIN | (toSend > 0 ? POLLOUT : 0);
+        if(poll(&pfd, 1, -1) < 0){
+            if(errno == EINTR){
+                continue;
+            }
+            return false;
+        }
+        if(toSend > 0 && (pfd.revents & POLLOUT)){
+            ssize_t n = send(fd, out, toSend, MSG_NOSIGNAL | MSG_DONTWAIT);
+            if(n < 0 && errno != EAGAIN && errno != EWOULDBLOCK){
+                return false;
+            }
+            if(n > 0){
+                out += n;
+                toSend -= n;
+            }
+        }
+        if(pfd.revents & (POLLIN | POLLHUP | POLLERR)){
+            ssize_t n = recv(fd, in, toRead, MSG_DONTWAIT);
+            if(n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)){
+                return false;
+            }
+            if(n > 0){
+                in += n;
+                toRead -= n;
+            }
+        }
+    }
+    return true;
+}
+
+void SocketClient::close()
+{
+    if(fd >= 0){
+        ::close(fd);
+    }
+    fd = -1;
+}
@@ -0,0 +1,129 @@
+/*
+Copyright (c) 2017, Robert Krook
+Copyright (c) 2017, Erik Almblad
+Copyright (c) 2017, Hawre Aziz
+Copyright (c) 2017, Alexander Branzell
+Copyright (c) 2017, Mattias Eriksson
+Copyright (c) 2017, Carl Hjerpe
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the Chalmers University of Technology nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef MAP_SOCKET_H
+#define MAP_SOCKET_H
+
+#include <stdint.h>
+#include <thread>
+#include <set>
+#include "map.h"
+#include "shadow.h"
+
+#define DEFAULT_SOCKET_PATH     "/tmp/mapserver.sock"
+
+#define SOCKET_OP_MARKING_POS   1
+#define SOCKET_OP_FORBIDDEN_POS 2
+
+#define SOCKET_STATUS_OK        0
+#define SOCKET_STATUS_BAD_OP    1
+
+using namespace std;
+
+/*
+  Wire format of the local socket endpoint, fixed size frames in host byte
+  order. A client may write any number of requests back to back, responses
+  come back in the same order with the seq of their request.
+
+  SOCKET_OP_MARKING_POS:   a = marking id     -> a = x, b = y
+  SOCKET_OP_FORBIDDEN_POS: a = x, b = y       -> a = 1 if forbidden, else 0
+*/
+struct SocketRequest
+{
+    uint32_t seq;
+    uint32_t op;
+    int32_t a, b;
+};
+
+struct SocketResponse
+{
+    uint32_t seq;
+    uint32_t status;
+    int32_t a, b;
+};
+
+// Answers a batch of forbiddenPos queries with whatever engine is deployed
+typedef void (*ForbiddenBatchFn)(void *engine, const int *xs, const int *ys, int n, unsigned char *out);
+
+/*
+  Answers markingPos/forbiddenPos queries on a UNIX domain socket from its
+  own thread, with one epoll loop for all connections. forbiddenPos queries
+  go to forbiddenBatch, one call per read, or to Map if it isn't set.
+*/
+class SocketServer{
+    public:
+        SocketServer(Map *map, string path);
+        ~SocketServer();
+        bool start();
+        void stop();
+        void answer(SocketRequest *reqs, SocketResponse *res, int n);
+        ShadowVerifier *shadow;
+        ForbiddenBatchFn forbiddenBatch;
+        void *engine;
+
+    private:
+        struct Connection
+        {
+            int fd;
+            // the client has shut down its side
+            bool eof;
+            string in, out;
+        };
+        Map *map;
+        string path;
+        int listenFd, epollFd, stopFd;
+        thread worker;
+        set<Connection *> connections;
+        void run();
+        void drop(Connection *conn);
+        void accept();
+        bool serve(Connection *conn);
+        bool flush(Connection *conn);
+        bool isDone(Connection *conn);
+};
+
+/*
+  Blocking client for the socket endpoint.
+*/
+class SocketClient{
+    public:
+        SocketClient();
+        ~SocketClient();
+        bool connect(string path);
+        bool query(vector<SocketRequest> &reqs, vector<SocketResponse> &res);
+        void close();
+
+    private:
+        int fd;
+};
+
+#endif
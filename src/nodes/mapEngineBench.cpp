@@ -0,0 +1,216 @@
+/*
+Copyright (c) 2017, Robert Krook
+Copyright (c) 2017, Erik Almblad
+Copyright (c) 2017, Hawre Aziz
+Copyright (c) 2017, Alexander Branzell
+Copyright (c) 2017, Mattias Eriksson
+Copyright (c) 2017, Carl Hjerpe
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the Chalmers University of Technology nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include <chrono>
+#include "../map.h"
+#include "../engine.h"
+
+using namespace std::chrono;
+
+#define BENCH_MARGIN    10
+
+/*
+  Query positions spread over the bounding box of the map plus a margin,
+  so that both the inside and the outside of the map get exercised.
+*/
+void makeQueries(Map &map, int count, vector<int> &xs, vector<int> &ys)
+{
+    int minX = 0, minY = 0, maxX = 0, maxY = 0;
+    bool first = true;
+    for(int p = 0; p < map.polygons.size(); p++){
+        BBox box = boundingBox(map.polygons[p]);
+        if(box.empty){
+            continue;
+        }
+        if(first){
+            minX = box.minX; minY = box.minY; maxX = box.maxX; maxY = box.maxY;
+            first = false;
+        }
+        minX = min(minX, box.minX); maxX = max(maxX, box.maxX);
+        minY = min(minY, box.minY); maxY = max(maxY, box.maxY);
+    }
+    minX -= BENCH_MARGIN; minY -= BENCH_MARGIN;
+    maxX += BENCH_MARGIN; maxY += BENCH_MARGIN;
+
+    unsigned int seed = 12345;
+    xs.resize(count);
+    ys.resize(count);
+    for(int i = 0; i < count; i++){
+        seed = seed * 1103515245 + 12345;
+        xs[i] = minX + (int)((seed >> 8) % (unsigned int)(maxX - minX + 1));
+        seed = seed * 1103515245 + 12345;
+        ys[i] = minY + (int)((seed >> 8) % (unsigned int)(maxY - minY + 1));
+    }
+}
+
+/*
+  Builds one engine and times its point, batch and marking queries. The
+  answers are compared with the reference answers in expected.
+*/
+template<class Engine>
+void bench(Map &map, vector<int> &xs, vector<int> &ys, vector<unsigned char> &expected)
+{
+    int n = xs.size();
+    Engine engine(&map);
+
+    steady_clock::time_point start = steady_clock::now();
+    engine.build();
+    double buildTime = duration<double>(steady_clock::now() - start).count();
+
+    vector<unsigned char> answers(n);
+    start = steady_clock::now();
+    for(int i = 0; i < n; i++){
+        answers[i] = engine.isForbidden(xs[i], ys[i]);
+    }
+    double pointTime = duration<double>(steady_clock::now() - start).count();
+
+    vector<unsigned char> batch(n);
+    start = steady_clock::now();
+    engine.isForbiddenBatch(xs.data(), ys.data(), n, batch.data());
+    double batchTime = duration<double>(steady_clock::now() - start).count();
+
+    int ids = max((int)map.markings.size(), 1);
+    long long checksum = 0;
+    start = steady_clock::now();
+    for(int i = 0; i < n; i++){
+        int x, y;
+        engine.getMarkingPos(map.markings.empty() ? i : map.markings[i % ids].id, x, y);
+        checksum += x + y;
+    }
+    double markingTime = duration<double>(steady_clock::now() - start).count();
+
+    int mismatches = 0;
+    for(int i = 0; i < n; i++){
+        mismatches += answers[i] != expected[i] || batch[i] != expected[i];
+    }
+    printf("%-8s build %9.3f ms  point %8.1f ns  batch %8.1f ns  marking %8.1f ns  mismatches %d (%lld)\n",
+           Engine::name(), buildTime * 1e3, pointTime * 1e9 / n, batchTime * 1e9 / n,
+           markingTime * 1e9 / n, mismatches, checksum);
+}
+
+/*
+  Forbidden test over all polygons with one of the crossing kernels of
+  crossing.h in place of the one in Map::isPosInPoly.
+*/
+template<bool (*Crosses)(int, int, int, int, int, int)>
+bool kernelForbidden(Map &map, int x, int y)
+{
+    for(int p = 0; p < map.polygons.size(); p++){
+        Polygon &poly = map.polygons[p];
+        bool c = false;
+        for(int i = 0, j = poly.numOfNodes-1; i < poly.numOfNodes; j = i++){
+            Node &prevNode = poly.nodes[j];
+            Node &curNode = poly.nodes[i];
+            if(curNode.x == x && curNode.y == y){
+                c = true;
+                break;
+            }
+            c ^= Crosses(curNode.x, curNode.y, prevNode.x, prevNode.y, x, y);
+        }
+        if(c != poly.allowedInside){
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+  Times one crossing kernel per edge and counts the positions where its
+  answer differs from the division kernel. Only the exact kernel is
+  expected to differ, next to the edges.
+*/
+template<bool (*Crosses)(int, int, int, int, int, int)>
+void benchKernel(const char *name, Map &map, vector<int> &xs, vector<int> &ys, vector<unsigned char> &expected)
+{
+    int n = xs.size();
+    long long edges = 0;
+    for(int p = 0; p < map.polygons.size(); p++){
+        edges += max(map.polygons[p].numOfNodes, 0);
+    }
+    vector<unsigned char> answers(n);
+    steady_clock::time_point start = steady_clock::now();
+    for(int i = 0; i < n; i++){
+        answers[i] = kernelForbidden<Crosses>(map, xs[i], ys[i]);
+    }
+    double time = duration<double>(steady_clock::now() - start).count();
+    int differs = 0;
+    for(int i = 0; i < n; i++){
+        differs += answers[i] != expected[i];
+    }
+    printf("kernel %-8s %8.2f ns/edge  differs %d\n", name, time * 1e9 / ((double)n * max(edges, 1LL)), differs);
+}
+
+/*
+  Times every query engine on the same map and the same random positions.
+  Without a map file it uses db.db like mapServer does.
+*/
+int main(int argc, char **argv)
+{
+    if(argc > 3){
+        cout << "usage: mapEngineBench [map file] [queries]" << endl;
+        return 1;
+    }
+    Map *map;
+    if(argc > 1){
+        map = new Map();
+        map->polygons.clear();
+        map->markings.clear();
+        map->footprints.clear();
+        map->load(argv[1]);
+    }else{
+        map = new Map();
+    }
+    int count = (argc > 2) ? atoi(argv[2]) : 1000000;
+
+    vector<int> xs, ys;
+    makeQueries(*map, count, xs, ys);
+    vector<unsigned char> expected(count);
+    for(int i = 0; i < count; i++){
+        expected[i] = map->isForbidden(xs[i], ys[i]);
+    }
+
+    vector<unsigned char> division(count);
+    for(int i = 0; i < count; i++){
+        division[i] = kernelForbidden<crossesDivision>(*map, xs[i], ys[i]);
+    }
+    benchKernel<crossesDivision>("division", *map, xs, ys, division);
+    benchKernel<crossesCompat>("compat", *map, xs, ys, division);
+    benchKernel<crossesExact>("exact", *map, xs, ys, division);
+
+    bench<LinearEngine>(*map, xs, ys, expected);
+    bench<IndexedEngine>(*map, xs, ys, expected);
+    bench<RasterEngine>(*map, xs, ys, expected);
+    bench<SimdEngine>(*map, xs, ys, expected);
+    // compacts the map, so it goes last
+    bench<CompactEngine>(*map, xs, ys, expected);
+    delete map;
+    return 0;
+}
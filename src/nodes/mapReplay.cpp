@@ -0,0 +1,186 @@
+/*
+Copyright (c) 2017, Robert Krook
+Copyright (c) 2017, Erik Almblad
+Copyright (c) 2017, Hawre Aziz
+Copyright (c) 2017, Alexander Branzell
+Copyright (c) 2017, Mattias Eriksson
+Copyright (c) 2017, Carl Hjerpe
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the Chalmers University of Technology nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include <thread>
+#include <chrono>
+#include "ros/ros.h"
+#include "mapserver/getMarkPos.h"
+#include "mapserver/isFPos.h"
+#include "../map.h"
+#include "../normalize.h"
+#include "../queryLog.h"
+
+#define MODE_MAP        "map"
+#define MODE_LIVE       "live"
+#define MAX_REPORTED    10
+
+using namespace std::chrono;
+
+/*
+  Asks either a local Map or the live services, returns false if the
+  services could not be called.
+*/
+bool replayOne(QueryRecord &rec, Map *map, ros::ServiceClient &markClient,
+               ros::ServiceClient &forbiddenClient, int &resultA, int &resultB)
+{
+    resultA = resultB = 0;
+    if(rec.op == QUERY_MARKING_POS){
+        if(map != NULL){
+            map->getMarkingPos(rec.a, resultA, resultB);
+            return true;
+        }
+        mapserver::getMarkPos srv;
+        srv.request.id = rec.a;
+        if(!markClient.call(srv)){
+            return false;
+        }
+        resultA = srv.response.x;
+        resultB = srv.response.y;
+    }else if(rec.op == QUERY_FORBIDDEN_POS){
+        if(map != NULL){
+            resultA = map->isForbidden(rec.a, rec.b);
+            return true;
+        }
+        mapserver::isFPos srv;
+        srv.request.x = rec.a;
+        srv.request.y = rec.b;
+        if(!forbiddenClient.call(srv)){
+            return false;
+        }
+        resultA = srv.response.b;
+    }
+    return true;
+}
+
+/*
+  Handler threads take their timestamp before they reserve a slot in the
+  capture, so the records are only roughly in time order.
+*/
+bool earlierRecord(const QueryRecord &a, const QueryRecord &b)
+{
+    return a.timeNs < b.timeNs;
+}
+
+double percentile(vector<double> &sorted, double p)
+{
+    if(sorted.empty()){
+        return 0;
+    }
+    size_t index = (size_t)(p / 100.0 * (sorted.size() - 1) + 0.5);
+    return sorted[index];
+}
+
+/*
+  Replays a capture file from mapServer (~capture_path) against a Map built
+  from db.db or against the running services. speed 1 keeps the recorded
+  spacing between queries, 10 replays ten times faster and 0 as fast as
+  possible. Every answer is compared with the recorded one.
+*/
+int main(int argc, char **argv)
+{
+    ros::init(argc, argv, "mapReplay");
+    if(argc < 2 || argc > 4){
+        ROS_INFO("usage: mapReplay capture [map|live] [speed]");
+        return 1;
+    }
+    string mode = (argc > 2) ? argv[2] : MODE_MAP;
+    double speed = (argc > 3) ? atof(argv[3]) : 1.0;
+    if(mode != MODE_MAP && mode != MODE_LIVE){
+        ROS_ERROR("mode has to be %s or %s", MODE_MAP, MODE_LIVE);
+        return 1;
+    }
+
+    vector<QueryRecord> records;
+    if(!readQueryLog(argv[1], records)){
+        return 1;
+    }
+    ROS_INFO("%d recorded queries", (int)records.size());
+    if(records.empty()){
+        return 0;
+    }
+    stable_sort(records.begin(), records.end(), earlierRecord);
+
+    ros::NodeHandle n;
+    ros::NodeHandle pn("~");
+    Map *map = NULL;
+    ros::ServiceClient markClient, forbiddenClient;
+    if(mode == MODE_MAP){
+        // prepare the map the same way mapServer does
+        bool normalize;
+        double simplifyTolerance;
+        pn.param("normalize", normalize, false);
+        pn.param("simplify_tolerance", simplifyTolerance, 0.0);
+        map = new Map();
+        if(normalize){
+            MapNormalizer normalizer(map);
+            normalizer.normalize(simplifyTolerance);
+        }
+    }else{
+        markClient = n.serviceClient<mapserver::getMarkPos>("markingPos", true);
+        forbiddenClient = n.serviceClient<mapserver::isFPos>("forbiddenPos", true);
+    }
+
+    vector<double> latencies;
+    int mismatches = 0, failures = 0;
+    steady_clock::time_point begin = steady_clock::now();
+    for(int i = 0; i < records.size(); i++){
+        QueryRecord &rec = records[i];
+        if(speed > 0){
+            uint64_t offset = (uint64_t)((rec.timeNs - records[0].timeNs) / speed);
+            this_thread::sleep_until(begin + nanoseconds(offset));
+        }
+
+        int resultA, resultB;
+        steady_clock::time_point start = steady_clock::now();
+        bool ok = replayOne(rec, map, markClient, forbiddenClient, resultA, resultB);
+        latencies.push_back(duration<double, micro>(steady_clock::now() - start).count());
+
+        if(!ok){
+            failures++;
+        }else if(resultA != rec.resultA || resultB != rec.resultB){
+            if(mismatches < MAX_REPORTED){
+                ROS_WARN("mismatch: op %u (%d,%d) recorded (%d,%d) got (%d,%d)", rec.op,
+                         rec.a, rec.b, rec.resultA, rec.resultB, resultA, resultB);
+            }
+            mismatches++;
+        }
+    }
+    double total = duration<double>(steady_clock::now() - begin).count();
+
+    sort(latencies.begin(), latencies.end());
+    ROS_INFO("replayed %d queries in %.3f s, %d mismatches, %d failed calls",
+             (int)records.size(), total, mismatches, failures);
+    ROS_INFO("latency us: p50 %.2f  p90 %.2f  p99 %.2f  p99.9 %.2f  max %.2f",
+             percentile(latencies, 50), percentile(latencies, 90), percentile(latencies, 99),
+             percentile(latencies, 99.9), latencies.back());
+    delete map;
+    return (mismatches == 0 && failures == 0) ? 0 : 2;
+}
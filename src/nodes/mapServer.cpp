@@ -29,20 +29,289 @@ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
 (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
 SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <atomic>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
 #include "ros/ros.h"
+#include "ros/callback_queue.h"
 #include "mapserver/getMarkPos.h"
 #include "mapserver/isFPos.h"
+#include "mapserver/getRoute.h"
+#include "mapserver/isFootprintFPos.h"
+#include "mapserver/regionQuery.h"
+#include "mapserver/mapStatus.h"
+#include "mapserver/shadowStats.h"
+#include "mapserver/isFPosPrio.h"
+#include "mapserver/getMarkPosPrio.h"
+#include "mapserver/schedStats.h"
+#include "mapserver/zoneAttributes.h"
 #include "../map.h"
+#include "../route.h"
+#include "../footprint.h"
+#include "../raster.h"
+#include "../normalize.h"
+#include "../mapSocket.h"
+#include "../queryLog.h"
+#include "../shadow.h"
+#include "../engine.h"
+#include "../scheduler.h"
+#include "../zones.h"
 
-Map g_map;
+#define POLICY_BLOCK    "block"
+#define POLICY_REJECT   "reject"
 
+// Settings read from the private node handle before the map is loaded
+struct LoadSettings
+{
+    bool normalize;
+    double simplifyTolerance;
+    int routeCacheSize;
+    int rasterMaxCells;
+    string socketPath;
+    double shadowSampleRate;
+    int shadowQueueLimit;
+    int shadowMaxReproducers;
+    void (*buildEngine)(Map *map, ForbiddenRaster *raster, SocketServer *socket);
+};
+
+// Everything below is only touched by the handlers once g_ready is set
+Map *g_map;
+RouteCache *g_routes;
+atomic<bool> g_routesReady(false);
+atomic<bool> g_rasterReady(false);
+thread g_builder;
+FootprintZones *g_footprints;
+ZoneLayer *g_zones;
+ForbiddenRaster *g_raster;
+SocketServer *g_socket;
+ShadowVerifier *g_shadow;
+QueryLogWriter g_capture;
+
+mutex g_readyMutex;
+condition_variable g_readyCond;
+bool g_ready = false;
+double g_loadSeconds = 0;
+bool g_rejectEarlyCalls = false;
+double g_earlyCallDeadline = 5.0;
+
+// NULL unless ~sched_slots is set, calls without a priority of their own
+// are scheduled with g_defaultPriority and no deadline
+Scheduler *g_scheduler = NULL;
+int g_defaultPriority = mapserver::isFPosPrio::Request::PRIORITY_NORMAL;
+
+// The engine answering markingPos/forbiddenPos, one instance per engine
+// type so the handlers below are compiled against the concrete class
+template<class Engine>
+struct Deployed
+{
+    static Engine *engine;
+};
+template<class Engine> Engine *Deployed<Engine>::engine = NULL;
+
+template<class Engine>
+void engineBatch(void *engine, const int *xs, const int *ys, int n, unsigned char *out)
+{
+    ((Engine *)engine)->isForbiddenBatch(xs, ys, n, out);
+}
+
+template<class Engine>
+Engine *newEngine(Map *map, ForbiddenRaster *raster)
+{
+    return new Engine(map);
+}
+
+template<>
+RasterEngine *newEngine<RasterEngine>(Map *map, ForbiddenRaster *raster)
+{
+    return new RasterEngine(map, raster);
+}
+
+template<class Engine>
+void buildEngine(Map *map, ForbiddenRaster *raster, SocketServer *socket)
+{
+    Engine *engine = newEngine<Engine>(map, raster);
+    engine->build();
+    Deployed<Engine>::engine = engine;
+    if(socket != NULL){
+        socket->forbiddenBatch = engineBatch<Engine>;
+        socket->engine = engine;
+    }
+    ROS_INFO("Query engine: %s", Engine::name());
+}
+
+
+/*
+  Builds the forbidden raster for forbiddenRegion (unless the raster engine
+  already did) and the visibility graph for the route service. Both can
+  take seconds on big maps, so they are built after the point services are
+  ready.
+*/
+void buildInBackground()
+{
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    if(!g_raster->isBuilt()){
+        g_raster->build();
+    }
+    g_rasterReady = true;
+    ROS_INFO("forbidden raster: %d x %d in %.3f s", g_raster->width, g_raster->height,
+             chrono::duration<double>(chrono::steady_clock::now() - start).count());
+
+    start = chrono::steady_clock::now();
+    g_routes->rebuild();
+    g_routesReady = true;
+    ROS_INFO("route graph: %d nodes, %d edges in %.3f s", g_routes->graph.numOfNodes(), g_routes->graph.numOfEdges(),
+             chrono::duration<double>(chrono::steady_clock::now() - start).count());
+}
+
+/*
+  Parses the map file and builds all indexes on it, then lets the service
+  handlers in.
+*/
+void loadMap(LoadSettings settings)
+{
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+    Map *map = new Map();
+    if(settings.normalize){
+        MapNormalizer normalizer(map);
+        normalizer.normalize(settings.simplifyTolerance);
+        normalizer.printReport();
+    }
+
+    // the route graph is built on its own thread once the map is ready
+    RouteCache *routes = new RouteCache(map, settings.routeCacheSize);
 
+    FootprintZones *footprints = new FootprintZones(map);
+    footprints->build();
+
+    ZoneLayer *zones = new ZoneLayer(map);
+    zones->build();
+
+    // built in the background, or right away by the raster engine
+    ForbiddenRaster *raster = new ForbiddenRaster(map, settings.rasterMaxCells);
+
+    ShadowVerifier *shadow = new ShadowVerifier(map, settings.shadowSampleRate,
+                                                settings.shadowQueueLimit, settings.shadowMaxReproducers);
+    shadow->start();
+
+    SocketServer *socket = NULL;
+    if(!settings.socketPath.empty()){
+        socket = new SocketServer(map, settings.socketPath);
+        socket->shadow = shadow;
+    }
+    settings.buildEngine(map, raster, socket);
+#ifdef __GLIBC__
+    // the compact engine frees the node vectors of the map, glibc keeps
+    // the freed heap unless told to give it back
+    malloc_trim(0);
+#endif
+    if(socket != NULL){
+        if(socket->start()){
+            ROS_INFO("Serving on socket %s", settings.socketPath.c_str());
+        }
+    }
+
+    {
+        lock_guard<mutex> lock(g_readyMutex);
+        g_map = map;
+        g_routes = routes;
+        g_footprints = footprints;
+        g_zones = zones;
+        g_raster = raster;
+        g_socket = socket;
+        g_shadow = shadow;
+        g_loadSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        g_ready = true;
+        g_readyCond.notify_all();
+        ROS_INFO("Map loaded in %.3f s", g_loadSeconds);
+    }
+    g_builder = thread(buildInBackground);
+}
+
+/*
+  Called first thing by every handler. Depending on the policy a call that
+  comes in before the map is loaded either waits for it, up to a deadline,
+  or fails right away.
+*/
+bool waitForMap()
+{
+    unique_lock<mutex> lock(g_readyMutex);
+    if(g_ready){
+        return true;
+    }
+    if(!g_rejectEarlyCalls){
+        g_readyCond.wait_for(lock, chrono::duration<double>(g_earlyCallDeadline), []{ return g_ready; });
+    }
+    if(!g_ready){
+        ROS_WARN("Map not loaded yet, rejecting call");
+    }
+    return g_ready;
+}
+
+
+/*
+  Seconds left until the deadline of a call, a zero deadline means the
+  caller will wait for as long as it takes.
+*/
+double timeUntil(ros::Time deadline)
+{
+    if(deadline.isZero()){
+        return SCHED_NO_DEADLINE;
+    }
+    return max(0.0, (deadline - ros::Time::now()).toSec());
+}
+
+bool admitted(SchedSlot &slot, const char *service)
+{
+    if(slot.result == SCHED_EXPIRED){
+        ROS_WARN("%s: deadline passed before the call was served, shedding it", service);
+    }else if(slot.result == SCHED_REJECTED){
+        ROS_WARN("%s: queue full, rejecting call", service);
+    }
+    return slot.admitted();
+}
+
+template<class Engine>
+void markingPos(int id, int &x, int &y)
+{
+    uint64_t start = QueryLogWriter::now();
+    Deployed<Engine>::engine->getMarkingPos(id,x,y);
+    if(g_capture.isOpen()){
+        g_capture.record(QUERY_MARKING_POS, id, 0, x, y, start, QueryLogWriter::now() - start);
+    }
+}
+
+template<class Engine>
+bool forbiddenPos(int x, int y)
+{
+    uint64_t start = QueryLogWriter::now();
+    bool b = Deployed<Engine>::engine->isForbidden(x, y);
+    if(g_capture.isOpen()){
+        g_capture.record(QUERY_FORBIDDEN_POS, x, y, b, 0, start, QueryLogWriter::now() - start);
+    }
+    g_shadow->submit(x, y, b);
+    return b;
+}
+
+template<class Engine>
 bool getMarkingPosition(mapserver::getMarkPos::Request &req,
                    mapserver::getMarkPos::Response &res)
 {
+    if(!waitForMap()){
+        return false;
+    }
+    SchedSlot slot(g_scheduler, g_defaultPriority, SCHED_NO_DEADLINE);
+    if(!admitted(slot, "markingPos")){
+        return false;
+    }
     int id, x, y = 0;
     id = (int) req.id;
-    g_map.getMarkingPos(id,x,y);
+    markingPos<Engine>(id, x, y);
     res.x = x;
     res.y = y;
     ROS_INFO("request id: %d", req.id);
@@ -50,32 +319,385 @@ bool getMarkingPosition(mapserver::getMarkPos::Request &req,
     return true;
 }
 
+template<class Engine>
 bool isForbiddenPos(mapserver::isFPos::Request &req,
                    mapserver::isFPos::Response &res)
 {
+    if(!waitForMap()){
+        return false;
+    }
+    SchedSlot slot(g_scheduler, g_defaultPriority, SCHED_NO_DEADLINE);
+    if(!admitted(slot, "forbiddenPos")){
+        return false;
+    }
     int x = req.x;
     int y = req.y;
     bool b = false;
-    g_map.isForbiddenPos(x, y, b);
+    b = forbiddenPos<Engine>(x, y);
     res.b = b;
     ROS_INFO("pos(%d,%d)", x, y);
     ROS_INFO("result: %d" + b );
     return true;
 }
 
+template<class Engine>
+bool getMarkingPositionPrio(mapserver::getMarkPosPrio::Request &req,
+                            mapserver::getMarkPosPrio::Response &res)
+{
+    if(!waitForMap()){
+        return false;
+    }
+    SchedSlot slot(g_scheduler, req.priority, timeUntil(req.deadline));
+    if(!admitted(slot, "markingPosPrio")){
+        return false;
+    }
+    int x, y;
+    markingPos<Engine>(req.id, x, y);
+    res.x = x;
+    res.y = y;
+    return true;
+}
+
+template<class Engine>
+bool isForbiddenPosPrio(mapserver::isFPosPrio::Request &req,
+                        mapserver::isFPosPrio::Response &res)
+{
+    if(!waitForMap()){
+        return false;
+    }
+    SchedSlot slot(g_scheduler, req.priority, timeUntil(req.deadline));
+    if(!admitted(slot, "forbiddenPosPrio")){
+        return false;
+    }
+    res.b = forbiddenPos<Engine>(req.x, req.y);
+    return true;
+}
+
+/*
+  The Safety endpoints take the same requests as the Prio ones but always
+  run at PRIORITY_SAFETY. They are served from a callback queue of their
+  own, see main.
+*/
+template<class Engine>
+bool getMarkingPositionSafety(mapserver::getMarkPosPrio::Request &req,
+                              mapserver::getMarkPosPrio::Response &res)
+{
+    req.priority = mapserver::getMarkPosPrio::Request::PRIORITY_SAFETY;
+    return getMarkingPositionPrio<Engine>(req, res);
+}
 
+template<class Engine>
+bool isForbiddenPosSafety(mapserver::isFPosPrio::Request &req,
+                          mapserver::isFPosPrio::Response &res)
+{
+    req.priority = mapserver::isFPosPrio::Request::PRIORITY_SAFETY;
+    return isForbiddenPosPrio<Engine>(req, res);
+}
+
+bool getRoute(mapserver::getRoute::Request &req,
+              mapserver::getRoute::Response &res)
+{
+    if(!waitForMap()){
+        return false;
+    }
+    if(!g_routesReady){
+        ROS_WARN("route graph not built yet, rejecting call");
+        return false;
+    }
+    SchedSlot slot(g_scheduler, g_defaultPriority, SCHED_NO_DEADLINE);
+    if(!admitted(slot, "route")){
+        return false;
+    }
+    vector<Node> route;
+    double length;
+    res.found = g_routes->getRoute(req.fromId, req.toId, route, length);
+    res.length = length;
+    for(int i = 0; i < route.size(); i++){
+        res.x.push_back(route[i].x);
+        res.y.push_back(route[i].y);
+    }
+    ROS_INFO("route %d -> %d: found %d, %d waypoints", req.fromId, req.toId, res.found, (int)route.size());
+    return true;
+}
+
+bool isFootprintForbidden(mapserver::isFootprintFPos::Request &req,
+                          mapserver::isFootprintFPos::Response &res)
+{
+    if(!waitForMap()){
+        return false;
+    }
+    SchedSlot slot(g_scheduler, g_defaultPriority, SCHED_NO_DEADLINE);
+    if(!admitted(slot, "footprintForbiddenPos")){
+        return false;
+    }
+    bool b = true;
+    if(!g_footprints->isFootprintForbidden(req.x, req.y, req.footprint, b)){
+        ROS_ERROR("unknown footprint class %d", req.footprint);
+        return false;
+    }
+    res.b = b;
+    return true;
+}
+
+bool forbiddenRegion(mapserver::regionQuery::Request &req,
+                     mapserver::regionQuery::Response &res)
+{
+    if(!waitForMap()){
+        return false;
+    }
+    if(!g_rasterReady){
+        ROS_WARN("forbidden raster not built yet, rejecting call");
+        return false;
+    }
+    SchedSlot slot(g_scheduler, g_defaultPriority, SCHED_NO_DEADLINE);
+    if(!admitted(slot, "forbiddenRegion")){
+        return false;
+    }
+    long long forbidden, total;
+    if(!g_raster->regionQuery(req.x0, req.y0, req.x1, req.y1, forbidden, total)){
+        ROS_WARN("forbiddenRegion: region (%d,%d) (%d,%d) is too large", req.x0, req.y0, req.x1, req.y1);
+        return false;
+    }
+    res.forbidden = forbidden;
+    res.total = total;
+    res.any = forbidden > 0;
+    res.all = forbidden == total;
+    return true;
+}
+
+bool zoneAttributes(mapserver::zoneAttributes::Request &req,
+                    mapserver::zoneAttributes::Response &res)
+{
+    if(!waitForMap()){
+        return false;
+    }
+    SchedSlot slot(g_scheduler, g_defaultPriority, SCHED_NO_DEADLINE);
+    if(!admitted(slot, "zoneAttributes")){
+        return false;
+    }
+    ZoneAttributes attributes;
+    g_zones->query(req.x, req.y, attributes);
+    res.flags = attributes.flags;
+    res.speedLimit = attributes.speedLimit;
+    res.heading = attributes.heading;
+    return true;
+}
+
+bool mapStatus(mapserver::mapStatus::Request &req,
+               mapserver::mapStatus::Response &res)
+{
+    lock_guard<mutex> lock(g_readyMutex);
+    res.ready = g_ready;
+    res.loadSeconds = g_loadSeconds;
+    res.routesReady = g_routesReady;
+    res.rasterReady = g_rasterReady;
+    return true;
+}
+
+bool shadowStats(mapserver::shadowStats::Request &req,
+                 mapserver::shadowStats::Response &res)
+{
+    if(!waitForMap()){
+        return false;
+    }
+    res.submitted = g_shadow->submitted;
+    res.checked = g_shadow->checked;
+    res.mismatches = g_shadow->mismatches;
+    res.dropped = g_shadow->dropped;
+    vector<Reproducer> reproducers;
+    g_shadow->getReproducers(reproducers);
+    for(int i = 0; i < reproducers.size(); i++){
+        res.x.push_back(reproducers[i].x);
+        res.y.push_back(reproducers[i].y);
+    }
+    return true;
+}
+
+bool schedStats(mapserver::schedStats::Request &req,
+                mapserver::schedStats::Response &res)
+{
+    if(g_scheduler == NULL){
+        // calls are only shed when their deadline has already passed
+        res.depth = 0; res.maxDepth = 0; res.busy = 0; res.slots = 0;
+        res.admitted = 0; res.expired = SchedSlot::expiredUnscheduled; res.rejected = 0; res.evicted = 0;
+        return true;
+    }
+    SchedStats stats;
+    g_scheduler->getStats(stats);
+    res.depth = stats.depth;
+    res.maxDepth = stats.maxDepth;
+    res.busy = stats.busy;
+    res.slots = stats.slots;
+    res.admitted = stats.admitted;
+    res.expired = stats.expired;
+    res.rejected = stats.rejected;
+    res.evicted = stats.evicted;
+    res.depthByPriority = stats.depthByPriority;
+    return true;
+}
+
+typedef void (*Advertiser)(ros::NodeHandle &n, ros::NodeHandle &prio, ros::NodeHandle &safety,
+                           vector<ros::ServiceServer> &services);
+
+template<class Engine>
+void advertiseEngine(ros::NodeHandle &n, ros::NodeHandle &prio, ros::NodeHandle &safety,
+                     vector<ros::ServiceServer> &services)
+{
+    services.push_back(n.advertiseService("markingPos", getMarkingPosition<Engine>));
+    services.push_back(n.advertiseService("forbiddenPos", isForbiddenPos<Engine>));
+    services.push_back(prio.advertiseService("markingPosPrio", getMarkingPositionPrio<Engine>));
+    services.push_back(prio.advertiseService("forbiddenPosPrio", isForbiddenPosPrio<Engine>));
+    services.push_back(safety.advertiseService("markingPosSafety", getMarkingPositionSafety<Engine>));
+    services.push_back(safety.advertiseService("forbiddenPosSafety", isForbiddenPosSafety<Engine>));
+}
+
+template<class Engine>
+void selectEngine(LoadSettings &settings, Advertiser &advertise)
+{
+    settings.buildEngine = buildEngine<Engine>;
+    advertise = advertiseEngine<Engine>;
+}
 
 
 int main(int argc, char **argv)
 {
     ros::init(argc, argv, "mapserver");
     ros::NodeHandle n;
+    ros::NodeHandle pn("~");
+
+    LoadSettings settings;
+    pn.param("normalize", settings.normalize, false);
+    pn.param("simplify_tolerance", settings.simplifyTolerance, 0.0);
+    pn.param("route_cache_size", settings.routeCacheSize, 64);
+    pn.param("raster_max_cells", settings.rasterMaxCells, RASTER_MAX_CELLS);
+    pn.param("socket_path", settings.socketPath, string(""));
+    // Share of forbiddenPos answers re-checked against the reference
+    // crossing test on a background thread, 0 turns the shadow mode off
+    pn.param("shadow_sample_rate", settings.shadowSampleRate, 0.0);
+    pn.param("shadow_queue_limit", settings.shadowQueueLimit, 1024);
+    pn.param("shadow_max_reproducers", settings.shadowMaxReproducers, 100);
+
+    // Which engine answers markingPos/forbiddenPos, see engine.h
+    string queryEngine;
+    Advertiser advertise;
+    pn.param("query_engine", queryEngine, string(ENGINE_LINEAR));
+    if(queryEngine == ENGINE_INDEXED){
+        selectEngine<IndexedEngine>(settings, advertise);
+    }else if(queryEngine == ENGINE_RASTER){
+        selectEngine<RasterEngine>(settings, advertise);
+    }else if(queryEngine == ENGINE_SIMD){
+        selectEngine<SimdEngine>(settings, advertise);
+    }else if(queryEngine == ENGINE_COMPACT){
+        selectEngine<CompactEngine>(settings, advertise);
+    }else{
+        if(queryEngine != ENGINE_LINEAR){
+            ROS_ERROR("unknown query_engine %s, using %s", queryEngine.c_str(), ENGINE_LINEAR);
+        }
+        selectEngine<LinearEngine>(settings, advertise);
+    }
+
+    // With async_load the services are advertised right away and the map
+    // is loaded on a background thread. Under the block policy early calls
+    // hold their spinner thread until the map is ready, mapStatus and
+    // schedStats have a queue and thread of their own so they still answer.
+    bool asyncLoad;
+    int spinnerThreads;
+    string earlyCallPolicy;
+    pn.param("async_load", asyncLoad, false);
+    pn.param("spinner_threads", spinnerThreads, 4);
+    pn.param("early_call_policy", earlyCallPolicy, string(POLICY_BLOCK));
+    pn.param("early_call_deadline", g_earlyCallDeadline, 5.0);
+    if(earlyCallPolicy != POLICY_BLOCK && earlyCallPolicy != POLICY_REJECT){
+        ROS_ERROR("unknown early_call_policy %s, using %s", earlyCallPolicy.c_str(), POLICY_BLOCK);
+    }
+    g_rejectEarlyCalls = earlyCallPolicy == POLICY_REJECT;
+
+    // With sched_slots > 0 at most that many calls run at once, the rest
+    // wait by priority and deadline (see scheduler.h). The waiting happens
+    // on the spinner threads, so spinner_threads has to be well above
+    // sched_slots or calls queue up in ROS in arrival order instead.
+    // The Prio and Safety endpoints have callback queues and spinner
+    // threads of their own, so a safety call never waits in ROS behind
+    // plain calls the scheduler hasn't seen yet.
+    int schedSlots, schedQueueLimit;
+    pn.param("sched_slots", schedSlots, 0);
+    pn.param("sched_queue_limit", schedQueueLimit, 256);
+    pn.param("default_priority", g_defaultPriority, g_defaultPriority);
+    int prioThreads, safetyThreads;
+    pn.param("prio_spinner_threads", prioThreads, 2);
+    pn.param("safety_spinner_threads", safetyThreads, 1);
+    if(schedSlots > 0){
+        g_scheduler = new Scheduler(schedSlots, schedQueueLimit);
+        if(spinnerThreads <= schedSlots){
+            ROS_WARN("spinner_threads (%d) <= sched_slots (%d), priorities will have no effect", spinnerThreads, schedSlots);
+        }
+    }
+
+    // Every markingPos/forbiddenPos call is written to a ring of
+    // capture_capacity records, replay them with mapReplay
+    string capturePath;
+    int captureCapacity;
+    pn.param("capture_path", capturePath, string(""));
+    pn.param("capture_capacity", captureCapacity, 1 << 20);
+    if(!capturePath.empty() && g_capture.open(capturePath, captureCapacity)){
+        ROS_INFO("Capturing queries to %s", capturePath.c_str());
+    }
+
+    thread loader;
+    if(asyncLoad){
+        loader = thread(loadMap, settings);
+    }else{
+        loadMap(settings);
+    }
+
+    ros::CallbackQueue prioQueue, safetyQueue, statusQueue;
+    ros::NodeHandle prio, safety, status;
+    prio.setCallbackQueue(&prioQueue);
+    safety.setCallbackQueue(&safetyQueue);
+    status.setCallbackQueue(&statusQueue);
+    vector<ros::ServiceServer> engineServices;
+    advertise(n, prio, safety, engineServices);
+    ros::AsyncSpinner prioSpinner(prioThreads, &prioQueue);
+    ros::AsyncSpinner safetySpinner(safetyThreads, &safetyQueue);
+    prioSpinner.start();
+    safetySpinner.start();
+
+    ros::ServiceServer service3 = n.advertiseService("route", getRoute);
+
+    ros::ServiceServer service4 = n.advertiseService("footprintForbiddenPos", isFootprintForbidden);
+
+    ros::ServiceServer service5 = n.advertiseService("forbiddenRegion", forbiddenRegion);
+
+    ros::ServiceServer service6 = status.advertiseService("mapStatus", mapStatus);
+
+    ros::ServiceServer service7 = n.advertiseService("shadowStats", shadowStats);
+
+    ros::ServiceServer service8 = status.advertiseService("schedStats", schedStats);
 
-    ros::ServiceServer service1 = n.advertiseService("markingPos", getMarkingPosition);
+    ros::ServiceServer service9 = n.advertiseService("zoneAttributes", zoneAttributes);
 
-    ros::ServiceServer service2 = n.advertiseService("forbiddenPos", isForbiddenPos);
+    ros::AsyncSpinner statusSpinner(1, &statusQueue);
+    statusSpinner.start();
    
     ROS_INFO("Ready to serve");
-    ros::spin();
+    if(asyncLoad || g_scheduler != NULL){
+        ros::AsyncSpinner spinner(spinnerThreads);
+        spinner.start();
+        ros::waitForShutdown();
+        if(loader.joinable()){
+            loader.join();
+        }
+    }else{
+        ros::spin();
+    }
+    prioSpinner.stop();
+    safetySpinner.stop();
+    statusSpinner.stop();
+    if(g_builder.joinable()){
+        g_builder.join();
+    }
+    delete g_socket;
+    delete g_shadow;
+    delete g_scheduler;
     return 0;
 }
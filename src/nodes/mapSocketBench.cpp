@@ -0,0 +1,122 @@
+/*
+Copyright (c) 2017, Robert Krook
+Copyright (c) 2017, Erik Almblad
+Copyright (c) 2017, Hawre Aziz
+Copyright (c) 2017, Alexander Branzell
+Copyright (c) 2017, Mattias Eriksson
+Copyright (c) 2017, Carl Hjerpe
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the Chalmers University of Technology nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include <chrono>
+#include "ros/ros.h"
+#include "mapserver/isFPos.h"
+#include "../mapSocket.h"
+
+using namespace std::chrono;
+
+#define GRID_SIZE 100
+
+/*
+  Times the same forbiddenPos queries over the ROS service, over the socket
+  one request at a time, and over the socket in pipelined batches.
+*/
+int main(int argc, char **argv)
+{
+    ros::init(argc, argv, "mapSocketBench");
+    if(argc < 2 || argc > 4){
+        ROS_INFO("usage: mapSocketBench count [batch] [socket path]");
+        return 1;
+    }
+    int count = atoi(argv[1]);
+    int batch = (argc > 2) ? atoi(argv[2]) : 64;
+    string path = (argc > 3) ? argv[3] : DEFAULT_SOCKET_PATH;
+    if(count <= 0 || batch <= 0){
+        ROS_ERROR("count and batch have to be positive");
+        return 1;
+    }
+
+    ros::NodeHandle n;
+    ros::ServiceClient service = n.serviceClient<mapserver::isFPos>("forbiddenPos", true);
+    SocketClient client;
+    if(!client.connect(path)){
+        ROS_ERROR("Failed to connect to %s", path.c_str());
+        return 1;
+    }
+
+    vector<SocketRequest> reqs(count);
+    for(int i = 0; i < count; i++){
+        reqs[i].seq = i;
+        reqs[i].op = SOCKET_OP_FORBIDDEN_POS;
+        reqs[i].a = i % GRID_SIZE;
+        reqs[i].b = (i / GRID_SIZE) % GRID_SIZE;
+    }
+
+    steady_clock::time_point start = steady_clock::now();
+    vector<int> rosAnswers(count);
+    for(int i = 0; i < count; i++){
+        mapserver::isFPos srv;
+        srv.request.x = reqs[i].a;
+        srv.request.y = reqs[i].b;
+        if(!service.call(srv)){
+            ROS_ERROR("Failed to call service ..");
+            return 1;
+        }
+        rosAnswers[i] = srv.response.b;
+    }
+    double rosTime = duration<double>(steady_clock::now() - start).count();
+
+    start = steady_clock::now();
+    vector<SocketRequest> one(1);
+    vector<SocketResponse> res;
+    int mismatches = 0;
+    for(int i = 0; i < count; i++){
+        one[0] = reqs[i];
+        if(!client.query(one, res)){
+            ROS_ERROR("Failed to query socket ..");
+            return 1;
+        }
+        mismatches += res[0].a != rosAnswers[i];
+    }
+    double singleTime = duration<double>(steady_clock::now() - start).count();
+
+    start = steady_clock::now();
+    for(int i = 0; i < count; i += batch){
+        vector<SocketRequest> chunk(reqs.begin() + i, reqs.begin() + min(i + batch, count));
+        if(!client.query(chunk, res)){
+            ROS_ERROR("Failed to query socket ..");
+            return 1;
+        }
+        for(int k = 0; k < res.size(); k++){
+            mismatches += res[k].a != rosAnswers[i + k];
+        }
+    }
+    double batchTime = duration<double>(steady_clock::now() - start).count();
+
+    ROS_INFO("%d queries, %d mismatches", count, mismatches);
+    ROS_INFO("ros service:          %10.2f us/query", rosTime * 1e6 / count);
+    ROS_INFO("socket, one by one:   %10.2f us/query", singleTime * 1e6 / count);
+    ROS_INFO("socket, batch of %4d: %10.2f us/query", batch, batchTime * 1e6 / count);
+    return 0;
+}
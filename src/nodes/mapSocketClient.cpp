@@ -0,0 +1,63 @@
+/*
+Copyright (c) 2017, Robert Krook
+Copyright (c) 2017, Erik Almblad
+Copyright (c) 2017, Hawre Aziz
+Copyright (c) 2017, Alexander Branzell
+Copyright (c) 2017, Mattias Eriksson
+Copyright (c) 2017, Carl Hjerpe
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the Chalmers University of Technology nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include "../mapSocket.h"
+
+
+int main(int argc, char **argv)
+{
+    if(argc != 3 && argc != 4){
+        cout << "usage: mapSocketClient x y [socket path]" << endl;
+        return 1;
+    }
+    string path = (argc == 4) ? argv[3] : DEFAULT_SOCKET_PATH;
+
+    SocketClient client;
+    if(!client.connect(path)){
+        cerr << "Failed to connect to " << path << endl;
+        return 1;
+    }
+
+    vector<SocketRequest> reqs(1);
+    vector<SocketResponse> res;
+    reqs[0].seq = 0;
+    reqs[0].op = SOCKET_OP_FORBIDDEN_POS;
+    reqs[0].a = atoll(argv[1]);
+    reqs[0].b = atoll(argv[2]);
+    if(client.query(reqs, res) && res[0].status == SOCKET_STATUS_OK){
+        cout << "ans: " << res[0].a << endl;
+    }else{
+        cerr << "Failed to query socket .." << endl;
+        return 1;
+    }
+
+    return 0;
+}
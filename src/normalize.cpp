@@ -0,0 +1,297 @@
+/*
+Copyright (c) 2017, Robert Krook
+Copyright (c) 2017, Erik Almblad
+Copyright (c) 2017, Hawre Aziz
+Copyright (c) 2017, Alexander Branzell
+Copyright (c) 2017, Mattias Eriksson
+Copyright (c) 2017, Carl Hjerpe
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the Chalmers University of Technology nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <math.h>
+#include "normalize.h"
+#include "crossing.h"
+
+using namespace std;
+
+static long long cross(Node &a, Node &b, Node &c)
+{
+    return ((long long)b.x - a.x) * ((long long)c.y - a.y) - ((long long)b.y - a.y) * ((long long)c.x - a.x);
+}
+
+static long long doubleArea(Polygon &poly)
+{
+    long long area = 0;
+    for(int i = 0, j = poly.nodes.size()-1; i < poly.nodes.size(); j = i++){
+        area += (long long)poly.nodes[j].x * poly.nodes[i].y - (long long)poly.nodes[i].x * poly.nodes[j].y;
+    }
+    return area;
+}
+
+/*
+  True if p lies inside or on the triangle a,b,c.
+*/
+static bool inTriangle(Node &a, Node &b, Node &c, Node &p)
+{
+    long long d1 = cross(a, b, p), d2 = cross(b, c, p), d3 = cross(c, a, p);
+    bool hasNeg = d1 < 0 || d2 < 0 || d3 < 0;
+    bool hasPos = d1 > 0 || d2 > 0 || d3 > 0;
+    return !(hasNeg && hasPos);
+}
+
+/*
+  True if p lies on the segment a-b, end points included.
+*/
+static bool onSegment(Node &a, Node &b, Node &p)
+{
+    return cross(a, b, p) == 0 &&
+           min(a.x, b.x) <= p.x && p.x <= max(a.x, b.x) &&
+           min(a.y, b.y) <= p.y && p.y <= max(a.y, b.y);
+}
+
+static void renumber(Polygon &poly)
+{
+    for(int i = 0; i < poly.nodes.size(); i++){
+        poly.nodes[i].id = i;
+    }
+    poly.numOfNodes = poly.nodes.size();
+}
+
+MapNormalizer::MapNormalizer(Map *map)
+{
+    this->map = map;
+    nodesBefore = nodesAfter = 0;
+    duplicates = collinear = simplified = reversed = 0;
+}
+
+void MapNormalizer::removeDuplicates(Polygon &poly)
+{
+    vector<Node> nodes;
+    for(int i = 0; i < poly.nodes.size(); i++){
+        Node &node = poly.nodes[i];
+        if(!nodes.empty() && nodes.back().x == node.x && nodes.back().y == node.y){
+            duplicates++;
+            continue;
+        }
+        nodes.push_back(node);
+    }
+    while(nodes.size() > 1 && nodes.front().x == nodes.back().x && nodes.front().y == nodes.back().y){
+        nodes.pop_back();
+        duplicates++;
+    }
+    poly.nodes = nodes;
+}
+
+/*
+  Drops vertices that sit on the straight line between their neighbours.
+  Only called for polygons with area, so it can't eat the whole polygon.
+*/
+void MapNormalizer::removeCollinear(Polygon &poly)
+{
+    bool changed = true;
+    while(changed && poly.nodes.size() > 3){
+        changed = false;
+        for(int i = 0; i < poly.nodes.size() && poly.nodes.size() > 3; i++){
+            int n = poly.nodes.size();
+            Node &a = poly.nodes[(i + n - 1) % n];
+            Node &v = poly.nodes[i];
+            Node &b = poly.nodes[(i + 1) % n];
+            if(cross(a, v, b) == 0){
+                poly.nodes.erase(poly.nodes.begin() + i);
+                collinear++;
+                changed = true;
+                i--;
+            }
+        }
+    }
+}
+
+/*
+  True if removing vertex i turns no forbidden position allowed. Only the
+  crossings of the edges a-v, v-b and a-b differ, and all of them lie in
+  the bounding box of the triangle a,v,b, so only positions in there where
+  the crossings differ (or v itself, which stops being a vertex hit) are
+  tested against the whole polygon. Triangles with a bounding box over
+  SIMPLIFY_MAX_CELLS positions are never cut.
+*/
+bool MapNormalizer::keepsForbidden(Polygon &poly, int i)
+{
+    int n = poly.nodes.size();
+    Node a = poly.nodes[(i + n - 1) % n];
+    Node v = poly.nodes[i];
+    Node b = poly.nodes[(i + 1) % n];
+    int minX = min(a.x, min(v.x, b.x)), maxX = max(a.x, max(v.x, b.x));
+    int minY = min(a.y, min(v.y, b.y)), maxY = max(a.y, max(v.y, b.y));
+    if(((long long)maxX - minX + 1) * ((long long)maxY - minY + 1) > SIMPLIFY_MAX_CELLS){
+        return false;
+    }
+
+    Polygon before = poly;
+    before.numOfNodes = before.nodes.size();
+    Polygon after = before;
+    after.nodes.erase(after.nodes.begin() + i);
+    after.numOfNodes = after.nodes.size();
+    for(int y = minY; y <= maxY; y++){
+        for(int x = minX; x <= maxX; x++){
+            bool oldLocal = crossesCompat(v.x, v.y, a.x, a.y, x, y) != crossesCompat(b.x, b.y, v.x, v.y, x, y);
+            bool newLocal = crossesCompat(b.x, b.y, a.x, a.y, x, y);
+            if(oldLocal == newLocal && (x != v.x || y != v.y)){
+                continue;
+            }
+            bool wasForbidden = map->isPosInPoly(&before, x, y) != poly.allowedInside;
+            bool isForbidden = map->isPosInPoly(&after, x, y) != poly.allowedInside;
+            if(wasForbidden && !isForbidden){
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/*
+  Removes a vertex if it is within tolerance of the line between its
+  neighbours and cutting the corner grows the forbidden area: reflex
+  corners of forbidden inside polygons, convex corners of allowed inside
+  polygons. The cut off triangle may not contain any other vertex, so the
+  polygon stays simple, and no position may become allowed under the
+  crossing test the server answers with. Expects a counter clockwise
+  polygon.
+*/
+void MapNormalizer::simplify(Polygon &poly, double tolerance)
+{
+    bool changed = true;
+    while(changed && poly.nodes.size() > 3){
+        changed = false;
+        for(int i = 0; i < poly.nodes.size() && poly.nodes.size() > 3; i++){
+            int n = poly.nodes.size();
+            Node &a = poly.nodes[(i + n - 1) % n];
+            Node &v = poly.nodes[i];
+            Node &b = poly.nodes[(i + 1) % n];
+            long long turn = cross(a, v, b);
+            if(poly.allowedInside ? turn <= 0 : turn >= 0){
+                continue;
+            }
+            double base = hypot((double)b.x - a.x, (double)b.y - a.y);
+            if(base == 0 || fabs((double)turn) / base > tolerance){
+                continue;
+            }
+            bool empty = true;
+            for(int k = 0; k < n && empty; k++){
+                if(k == i || k == (i + n - 1) % n || k == (i + 1) % n){
+                    continue;
+                }
+                empty = !inTriangle(a, v, b, poly.nodes[k]);
+            }
+            if(empty && keepsForbidden(poly, i)){
+                poly.nodes.erase(poly.nodes.begin() + i);
+                simplified++;
+                changed = true;
+                i--;
+            }
+        }
+    }
+}
+
+/*
+  Looks for two edges that are not neighbours and still touch.
+*/
+bool MapNormalizer::isSelfIntersecting(Polygon &poly)
+{
+    int n = poly.nodes.size();
+    for(int i = 0; i < n; i++){
+        Node &a = poly.nodes[i];
+        Node &b = poly.nodes[(i + 1) % n];
+        for(int j = i + 2; j < n; j++){
+            if(i == 0 && j == n - 1){
+                continue;
+            }
+            Node &c = poly.nodes[j];
+            Node &d = poly.nodes[(j + 1) % n];
+            long long d1 = cross(a, b, c), d2 = cross(a, b, d);
+            long long d3 = cross(c, d, a), d4 = cross(c, d, b);
+            if(((d1 > 0 && d2 < 0) || (d1 < 0 && d2 > 0)) &&
+               ((d3 > 0 && d4 < 0) || (d3 < 0 && d4 > 0))){
+                return true;
+            }
+            if(onSegment(a, b, c) || onSegment(a, b, d) || onSegment(c, d, a) || onSegment(c, d, b)){
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+/*
+  A tolerance of 0 or less turns the simplification off.
+*/
+void MapNormalizer::normalize(double simplifyTolerance)
+{
+    nodesBefore = nodesAfter = 0;
+    duplicates = collinear = simplified = reversed = 0;
+    degenerate.clear();
+    selfIntersecting.clear();
+
+    for(int p = 0; p < map->polygons.size(); p++){
+        Polygon &poly = map->polygons[p];
+        nodesBefore += poly.nodes.size();
+
+        Polygon cleaned = poly;
+        removeDuplicates(cleaned);
+        long long area = doubleArea(cleaned);
+        if(cleaned.nodes.size() < 3 || area == 0){
+            // leave them alone, the crossing test still gives them a meaning
+            degenerate.push_back(p);
+            nodesAfter += poly.nodes.size();
+            continue;
+        }
+        if(area < 0){
+            reverse(cleaned.nodes.begin(), cleaned.nodes.end());
+            reversed++;
+        }
+        removeCollinear(cleaned);
+        if(isSelfIntersecting(cleaned)){
+            selfIntersecting.push_back(p);
+        }else if(simplifyTolerance > 0){
+            simplify(cleaned, simplifyTolerance);
+        }
+        renumber(cleaned);
+        poly = cleaned;
+        nodesAfter += poly.nodes.size();
+    }
+    map->mapChanged();
+}
+
+void MapNormalizer::printReport()
+{
+    cout << "Normalized map: " << nodesBefore << " -> " << nodesAfter << " nodes" << endl;
+    cout << "  duplicates: " << duplicates << " collinear: " << collinear
+         << " simplified: " << simplified << " reversed: " << reversed << endl;
+    for(int i = 0; i < degenerate.size(); i++){
+        cout << "  polygon " << degenerate[i] << " has no area" << endl;
+    }
+    for(int i = 0; i < selfIntersecting.size(); i++){
+        cout << "  polygon " << selfIntersecting[i] << " intersects itself" << endl;
+    }
+}
@@ -0,0 +1,72 @@
+/*
+Copyright (c) 2017, Robert Krook
+Copyright (c) 2017, Erik Almblad
+Copyright (c) 2017, Hawre Aziz
+Copyright (c) 2017, Alexander Branzell
+Copyright (c) 2017, Mattias Eriksson
+Copyright (c) 2017, Carl Hjerpe
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the Chalmers University of Technology nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef NORMALIZE_H
+#define NORMALIZE_H
+
+#include "map.h"
+
+using namespace std;
+
+// largest bounding box of a corner simplify checks position by position
+#define SIMPLIFY_MAX_CELLS  (1 << 18)
+
+/*
+  Load time clean up of the map polygons. Removes repeated and collinear
+  vertices, turns every polygon counter clockwise and reports polygons that
+  have no area or cross themselves. Optionally drops vertices that are
+  closer than a tolerance to the line between their neighbours, but only
+  where that grows the forbidden area.
+  This is not answer preserving: the crossing test truncates toward one end
+  of an edge and counts vertices as inside, so reversing a polygon or
+  removing a collinear vertex can flip the answer for points next to or on
+  the boundary. It is therefore off unless ~normalize is set.
+*/
+class MapNormalizer{
+    public:
+        MapNormalizer(Map *map);
+        void normalize(double simplifyTolerance);
+        void printReport();
+        int nodesBefore, nodesAfter;
+        int duplicates, collinear, simplified, reversed;
+        vector<int> degenerate, selfIntersecting;
+
+    private:
+        Map *map;
+        void removeDuplicates(Polygon &poly);
+        void removeCollinear(Polygon &poly);
+        void simplify(Polygon &poly, double tolerance);
+        bool keepsForbidden(Polygon &poly, int i);
+        bool isSelfIntersecting(Polygon &poly);
+};
+
+#endif
@@ -0,0 +1,147 @@
+/*
+Copyright (c) 2017, Robert Krook
+Copyright (c) 2017, Erik Almblad
+Copyright (c) 2017, Hawre Aziz
+Copyright (c) 2017, Alexander Branzell
+Copyright (c) 2017, Mattias Eriksson
+Copyright (c) 2017, Carl Hjerpe
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the Chalmers University of Technology nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <string.h>
+#include <errno.h>
+#include <chrono>
+#include "queryLog.h"
+
+using namespace std;
+
+QueryLogWriter::QueryLogWriter()
+{
+    header = NULL;
+    records = NULL;
+    mappedSize = 0;
+}
+
+QueryLogWriter::~QueryLogWriter()
+{
+    close();
+}
+
+uint64_t QueryLogWriter::now()
+{
+    return chrono::duration_cast<chrono::nanoseconds>(
+        chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/*
+  Creates (or truncates) the capture file with room for capacity records.
+*/
+bool QueryLogWriter::open(string path, uint64_t capacity)
+{
+    close();
+    if(capacity == 0){
+        return false;
+    }
+    mappedSize = sizeof(QueryLogHeader) + capacity * sizeof(QueryRecord);
+
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if(fd < 0 || ftruncate(fd, mappedSize) < 0){
+        cerr << "Cannot create capture file " << path << ": " << strerror(errno) << endl;
+        if(fd >= 0) ::close(fd);
+        return false;
+    }
+    void *mem = mmap(NULL, mappedSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if(mem == MAP_FAILED){
+        cerr << "Cannot map capture file " << path << ": " << strerror(errno) << endl;
+        return false;
+    }
+
+    header = (QueryLogHeader *)mem;
+    records = (QueryRecord *)(header + 1);
+    header->magic = QUERY_LOG_MAGIC;
+    header->version = QUERY_LOG_VERSION;
+    header->capacity = capacity;
+    header->next = 0;
+    return true;
+}
+
+void QueryLogWriter::record(uint32_t op, int32_t a, int32_t b, int32_t resultA, int32_t resultB,
+                            uint64_t timeNs, uint32_t latencyNs)
+{
+    if(header == NULL){
+        return;
+    }
+    uint64_t index = __atomic_fetch_add(&header->next, 1, __ATOMIC_RELAXED);
+    QueryRecord &rec = records[index % header->capacity];
+    rec.timeNs = timeNs;
+    rec.op = op;
+    rec.latencyNs = latencyNs;
+    rec.a = a;
+    rec.b = b;
+    rec.resultA = resultA;
+    rec.resultB = resultB;
+}
+
+void QueryLogWriter::close()
+{
+    if(header != NULL){
+        munmap(header, mappedSize);
+    }
+    header = NULL;
+    records = NULL;
+    mappedSize = 0;
+}
+
+bool QueryLogWriter::isOpen()
+{
+    return header != NULL;
+}
+
+bool readQueryLog(string path, vector<QueryRecord> &records)
+{
+    records.clear();
+    ifstream in(path.c_str(), ios::binary);
+    QueryLogHeader header;
+    if(!in || !in.read((char *)&header, sizeof(header)) ||
+       header.magic != QUERY_LOG_MAGIC || header.version != QUERY_LOG_VERSION){
+        cerr << "Not a capture file: " << path << endl;
+        return false;
+    }
+
+    vector<QueryRecord> ring(header.capacity);
+    if(!in.read((char *)ring.data(), ring.size() * sizeof(QueryRecord))){
+        cerr << "Capture file is cut short: " << path << endl;
+        return false;
+    }
+    uint64_t count = min(header.next, header.capacity);
+    uint64_t first = header.next - count;
+    for(uint64_t i = 0; i < count; i++){
+        records.push_back(ring[(first + i) % header.capacity]);
+    }
+    return true;
+}
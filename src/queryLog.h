@@ -0,0 +1,101 @@
+/*
+Copyright (c) 2017, Robert Krook
+Copyright (c) 2017, Erik Almblad
+Copyright (c) 2017, Hawre Aziz
+Copyright (c) 2017, Alexander Branzell
+Copyright (c) 2017, Mattias Eriksson
+Copyright (c) 2017, Carl Hjerpe
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the Chalmers University of Technology nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef QUERY_LOG_H
+#define QUERY_LOG_H
+
+#include <stdint.h>
+#include "map.h"
+
+#define QUERY_LOG_MAGIC     0x4c51504d  // "MPQL"
+#define QUERY_LOG_VERSION   1
+
+#define QUERY_MARKING_POS   1
+#define QUERY_FORBIDDEN_POS 2
+
+using namespace std;
+
+/*
+  A capture file is this header followed by capacity fixed size records
+  used as a ring, next is the number of records ever written so the oldest
+  one sits at next % capacity once the ring has wrapped.
+*/
+struct QueryLogHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t capacity;
+    uint64_t next;
+};
+
+/*
+  One answered query. timeNs is a steady clock stamp taken when the request
+  came in, latencyNs how long the map took to answer it.
+  QUERY_MARKING_POS:   a = id       result a,b = x,y
+  QUERY_FORBIDDEN_POS: a,b = x,y    result a = forbidden
+*/
+struct QueryRecord
+{
+    uint64_t timeNs;
+    uint32_t op;
+    uint32_t latencyNs;
+    int32_t a, b;
+    int32_t resultA, resultB;
+};
+
+/*
+  Appends records to a memory mapped capture file. record() can be called
+  from several threads at once.
+*/
+class QueryLogWriter{
+    public:
+        QueryLogWriter();
+        ~QueryLogWriter();
+        bool open(string path, uint64_t capacity);
+        void record(uint32_t op, int32_t a, int32_t b, int32_t resultA, int32_t resultB,
+                    uint64_t timeNs, uint32_t latencyNs);
+        void close();
+        bool isOpen();
+        static uint64_t now();
+
+    private:
+        QueryLogHeader *header;
+        QueryRecord *records;
+        size_t mappedSize;
+};
+
+/*
+  Reads a capture file back, oldest record first.
+*/
+bool readQueryLog(string path, vector<QueryRecord> &records);
+
+#endif
@@ -0,0 +1,259 @@
+/*
+Copyright (c) 2017, Robert Krook
+Copyright (c) 2017, Erik Almblad
+Copyright (c) 2017, Hawre Aziz
+Copyright (c) 2017, Alexander Branzell
+Copyright (c) 2017, Mattias Eriksson
+Copyright (c) 2017, Carl Hjerpe
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the Chalmers University of Technology nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <climits>
+#include "raster.h"
+
+using namespace std;
+
+ForbiddenRaster::ForbiddenRaster(Map *map, long long maxCells)
+{
+    this->map = map;
+    this->maxCells = maxCells;
+    builtRevision = NOT_BUILT;
+    minX = minY = maxX = maxY = 0;
+    width = height = 0;
+    empty = true;
+    outsideForbidden = false;
+    tooLarge = false;
+}
+
+bool ForbiddenRaster::isBuilt()
+{
+    return builtRevision == map->revision;
+}
+
+/*
+  Evaluates one row of the raster with the same crossing rule as
+  Map::isPosInPoly, but per polygon instead of per position: every edge that
+  crosses the row toggles all positions left of its intersection. A
+  polygon can only contain positions inside its bounding box, so only
+  polygons whose box spans the row are walked, and only over the columns
+  of their box. Outside of them a position is forbidden if it is left out
+  by any allowed inside polygon.
+*/
+void ForbiddenRaster::rasterRow(int y, vector<unsigned char> &row)
+{
+    row.assign(width, 0);
+    // per position, how many allowed inside polygons contain it
+    vector<int> allowedBy(width, 0);
+    vector<long long> crossings;
+    vector<int> hits;
+    int allowedPolygons = 0;
+    Polygon scratch;
+
+    for(int p = 0; p < boxes.size(); p++){
+        BBox &box = boxes[p];
+        allowedPolygons += allowedInside[p];
+        if(box.empty || y < box.minY || y > box.maxY){
+            continue;
+        }
+        Polygon &poly = map->polygonAt(p, scratch);
+        crossings.clear();
+        for(int i = 0, j = poly.numOfNodes-1; i < poly.numOfNodes; j = i++){
+            Node &prevNode = poly.nodes[j];
+            Node &curNode = poly.nodes[i];
+            if((curNode.y > y) != (prevNode.y > y)){
+                crossings.push_back(truncatedCrossingX(curNode.x, curNode.y, prevNode.x, prevNode.y, y));
+            }
+        }
+        sort(crossings.begin(), crossings.end());
+        hits.clear();
+        for(int i = 0; i < poly.numOfNodes; i++){
+            if(poly.nodes[i].y == y){
+                hits.push_back(poly.nodes[i].x);
+            }
+        }
+        sort(hits.begin(), hits.end());
+
+        // walk right to left, a position is inside if an odd number of
+        // intersections lie strictly to its right or if it is a vertex
+        int k = crossings.size(), h = hits.size();
+        bool c = false;
+        for(int x = box.maxX; x >= box.minX; x--){
+            while(k > 0 && crossings[k-1] > x){
+                c = !c;
+                k--;
+            }
+            while(h > 0 && hits[h-1] > x){
+                h--;
+            }
+            bool inside = c || (h > 0 && hits[h-1] == x);
+            if(inside && poly.allowedInside){
+                allowedBy[x - minX]++;
+            }else if(inside){
+                row[x - minX] = 1;
+            }
+        }
+    }
+    for(int x = 0; x < width; x++){
+        if(allowedBy[x] < allowedPolygons){
+            row[x] = 1;
+        }
+    }
+}
+
+/*
+  Returns false (and leaves the raster empty) if the bounding box of the map
+  has more positions than maxCells.
+*/
+bool ForbiddenRaster::build()
+{
+    sat.clear();
+    width = height = 0;
+    tooLarge = false;
+    builtRevision = map->revision;
+
+    bool first = true;
+    minX = minY = maxX = maxY = 0;
+    boxes.clear();
+    allowedInside.clear();
+    Polygon scratch;
+    for(int p = 0; p < map->numOfPolygons(); p++){
+        Polygon &poly = map->polygonAt(p, scratch);
+        BBox box = boundingBox(poly);
+        boxes.push_back(box);
+        allowedInside.push_back(poly.allowedInside);
+        if(box.empty){
+            continue;
+        }
+        if(first){
+            minX = box.minX; minY = box.minY;
+            maxX = box.maxX; maxY = box.maxY;
+            first = false;
+        }
+        minX = min(minX, box.minX); maxX = max(maxX, box.maxX);
+        minY = min(minY, box.minY); maxY = max(maxY, box.maxY);
+    }
+    empty = first;
+    if(empty){
+        outsideForbidden = map->isForbidden(0, 0);
+        return true;
+    }
+    // no edge can cross a row outside the bounding box, so every position
+    // out there gets the same answer
+    outsideForbidden = map->isForbidden(minX - 1, minY - 1);
+
+    long long cells = ((long long)maxX - minX + 1) * ((long long)maxY - minY + 1);
+    if(cells > maxCells){
+        cerr << "Map too large for the raster: " << cells << " positions" << endl;
+        tooLarge = true;
+        return false;
+    }
+    width = maxX - minX + 1;
+    height = maxY - minY + 1;
+
+    // sat[(y+1)*(width+1) + x+1] is the number of forbidden positions in
+    // the rectangle from (minX,minY) up to and including (x,y)
+    sat.assign((long long)(width + 1) * (height + 1), 0);
+    vector<unsigned char> row;
+    for(int y = 0; y < height; y++){
+        rasterRow(y + minY, row);
+        unsigned int rowSum = 0;
+        for(int x = 0; x < width; x++){
+            rowSum += row[x];
+            sat[(long long)(y+1) * (width+1) + x+1] = sat[(long long)y * (width+1) + x+1] + rowSum;
+        }
+    }
+    return true;
+}
+
+/*
+  Forbidden positions in a rectangle given in raster coordinates, which has
+  to be inside the raster.
+*/
+long long ForbiddenRaster::sum(int x0, int y0, int x1, int y1)
+{
+    long long w = width + 1;
+    return (long long)sat[(long long)(y1+1) * w + x1+1] - sat[(long long)y0 * w + x1+1]
+         - sat[(long long)(y1+1) * w + x0] + sat[(long long)y0 * w + x0];
+}
+
+bool ForbiddenRaster::isForbidden(int x, int y)
+{
+    if(!isBuilt()){
+        build();
+    }
+    if(tooLarge){
+        return map->isForbidden(x, y);
+    }
+    if(x < minX || y < minY || x >= minX + width || y >= minY + height){
+        return outsideForbidden;
+    }
+    return sum(x - minX, y - minY, x - minX, y - minY) > 0;
+}
+
+/*
+  Counts the forbidden positions in the rectangle with corners (x0,y0) and
+  (x1,y1), both included. Positions outside the bounding box of the map are
+  counted without testing them. If the raster could not be built, the part
+  inside the bounding box is tested position by position. Returns false if
+  the rectangle has more positions than fit in a long long, or if that part
+  has more positions than the raster was allowed.
+*/
+bool ForbiddenRaster::regionQuery(int x0, int y0, int x1, int y1, long long &forbidden, long long &total)
+{
+    if(x0 > x1) swap(x0, x1);
+    if(y0 > y1) swap(y0, y1);
+    forbidden = total = 0;
+    long long w = (long long)x1 - x0 + 1, h = (long long)y1 - y0 + 1;
+    if(w > LLONG_MAX / h){
+        return false;
+    }
+    total = w * h;
+
+    if(!isBuilt()){
+        build();
+    }
+
+    long long inside = 0;
+    int cx0 = max(x0, minX), cy0 = max(y0, minY);
+    int cx1 = min(x1, maxX), cy1 = min(y1, maxY);
+    if(!empty && cx0 <= cx1 && cy0 <= cy1){
+        inside = ((long long)cx1 - cx0 + 1) * ((long long)cy1 - cy0 + 1);
+        if(!tooLarge){
+            forbidden = sum(cx0 - minX, cy0 - minY, cx1 - minX, cy1 - minY);
+        }else if(inside > maxCells){
+            return false;
+        }else{
+            for(int y = cy0; y <= cy1; y++){
+                for(int x = cx0; x <= cx1; x++){
+                    forbidden += map->isForbidden(x, y);
+                }
+            }
+        }
+    }
+    if(outsideForbidden){
+        forbidden += total - inside;
+    }
+    return true;
+}
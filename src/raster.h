@@ -0,0 +1,74 @@
+/*
+Copyright (c) 2017, Robert Krook
+Copyright (c) 2017, Erik Almblad
+Copyright (c) 2017, Hawre Aziz
+Copyright (c) 2017, Alexander Branzell
+Copyright (c) 2017, Mattias Eriksson
+Copyright (c) 2017, Carl Hjerpe
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the Chalmers University of Technology nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef RASTER_H
+#define RASTER_H
+
+#include "map.h"
+
+// 16 MB of summed-area table
+#define RASTER_MAX_CELLS (4 * 1024 * 1024)
+
+using namespace std;
+
+/*
+  The forbidden/allowed answer of every integer position inside the bounding
+  box of the map polygons, kept as a summed-area table so that the number of
+  forbidden positions in any rectangle is four lookups. Positions outside
+  the bounding box all share the same answer.
+*/
+class ForbiddenRaster{
+    public:
+        ForbiddenRaster(Map *map, long long maxCells);
+        bool build();
+        bool isForbidden(int x, int y);
+        bool regionQuery(int x0, int y0, int x1, int y1, long long &forbidden, long long &total);
+        bool isBuilt();
+        unsigned long builtRevision;
+        // bounding box of the map, width and height are 0 without a raster
+        int minX, minY, maxX, maxY, width, height;
+
+    private:
+        Map *map;
+        long long maxCells;
+        bool outsideForbidden;
+        bool empty;
+        bool tooLarge;
+        vector<unsigned int> sat;
+        // per map polygon, used while building
+        vector<BBox> boxes;
+        vector<bool> allowedInside;
+        void rasterRow(int y, vector<unsigned char> &row);
+        long long sum(int x0, int y0, int x1, int y1);
+};
+
+#endif
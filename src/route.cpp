@@ -0,0 +1,646 @@
+/*
+Copyright (c) 2017, Robert Krook
+Copyright (c) 2017, Erik Almblad
+Copyright (c) 2017, Hawre Aziz
+Copyright (c) 2017, Alexander Branzell
+Copyright (c) 2017, Mattias Eriksson
+Copyright (c) 2017, Carl Hjerpe
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the Chalmers University of Technology nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <queue>
+#include <math.h>
+#include <stdlib.h>
+#include "route.h"
+
+using namespace std;
+
+/*
+  Orientation of c relative to the line a->b, >0 left, <0 right, 0 on it.
+*/
+static long long orient(long long ax, long long ay, long long bx, long long by,
+                        long long cx, long long cy)
+{
+    long long d = (bx - ax) * (cy - ay) - (by - ay) * (cx - ax);
+    return (d > 0) - (d < 0);
+}
+
+/*
+  True if c lies on the segment a-b strictly between its end points.
+  c has to be collinear with a and b.
+*/
+static bool strictlyBetween(Node &a, Node &b, Node &c)
+{
+    if((c.x == a.x && c.y == a.y) || (c.x == b.x && c.y == b.y)){
+        return false;
+    }
+    return min(a.x, b.x) <= c.x && c.x <= max(a.x, b.x) &&
+           min(a.y, b.y) <= c.y && c.y <= max(a.y, b.y);
+}
+
+/*
+  True if the segment p-q touches the polygon edge a-b anywhere except in
+  p or q themselves.
+*/
+static bool touchesEdge(Node &p, Node &q, Node &a, Node &b)
+{
+    long long o1 = orient(p.x, p.y, q.x, q.y, a.x, a.y);
+    long long o2 = orient(p.x, p.y, q.x, q.y, b.x, b.y);
+    long long o3 = orient(a.x, a.y, b.x, b.y, p.x, p.y);
+    long long o4 = orient(a.x, a.y, b.x, b.y, q.x, q.y);
+
+    if(o1 * o2 < 0 && o3 * o4 < 0){
+        return true;
+    }
+    if(o1 == 0 && strictlyBetween(p, q, a)){
+        return true;
+    }
+    if(o2 == 0 && strictlyBetween(p, q, b)){
+        return true;
+    }
+    if(o1 == 0 && o2 == 0){
+        // collinear, overlapping by more than a single point
+        long long lo = max(min(p.x, q.x), min(a.x, b.x));
+        long long hi = min(max(p.x, q.x), max(a.x, b.x));
+        if(p.x == q.x){
+            lo = max(min(p.y, q.y), min(a.y, b.y));
+            hi = min(max(p.y, q.y), max(a.y, b.y));
+        }
+        return lo < hi;
+    }
+    return false;
+}
+
+/*
+  Exact crossing number test for a point given in doubled coordinates, so
+  that segment midpoints can be tested without rounding. Only used for
+  points that are known not to lie on any polygon edge.
+*/
+static bool isDoubledPosInPoly(Polygon &poly, long long x2, long long y2)
+{
+    bool c = false;
+    for(int i = 0, j = poly.numOfNodes-1; i < poly.numOfNodes; j = i++){
+        long long xi = 2LL * poly.nodes[i].x, yi = 2LL * poly.nodes[i].y;
+        long long xj = 2LL * poly.nodes[j].x, yj = 2LL * poly.nodes[j].y;
+        if((yi > y2) != (yj > y2)){
+            // x2 < xi + (xj - xi) * (y2 - yi) / (yj - yi), without dividing
+            long long lhs = (x2 - xi) * (yj - yi);
+            long long rhs = (xj - xi) * (y2 - yi);
+            if((yj - yi > 0) ? lhs < rhs : lhs > rhs){
+                c = !c;
+            }
+        }
+    }
+    return c;
+}
+
+static long long commonDivisor(long long a, long long b)
+{
+    while(b != 0){
+        long long t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+RouteGraph::RouteGraph(Map *map)
+{
+    this->map = map;
+    builtRevision = NOT_BUILT;
+}
+
+int RouteGraph::numOfNodes()
+{
+    return nodes.size();
+}
+
+int RouteGraph::numOfEdges()
+{
+    int count = 0;
+    for(int i = 0; i < edges.size(); i++){
+        count += edges[i].size();
+    }
+    return count / 2;
+}
+
+/*
+  Puts every polygon edge in all grid cells its bounding box overlaps.
+*/
+void RouteGraph::buildGrid()
+{
+    segments.clear();
+    segmentPolygon.clear();
+    cells.clear();
+    gridMinX = gridMinY = 0;
+    cellSize = 1;
+    cellsX = cellsY = 0;
+
+    int maxX = 0, maxY = 0;
+    Polygon scratch;
+    for(int i = 0; i < map->numOfPolygons(); i++){
+        Polygon &poly = map->polygonAt(i, scratch);
+        for(int k = 0, j = poly.numOfNodes-1; k < poly.numOfNodes; j = k++){
+            Node &a = poly.nodes[j], &b = poly.nodes[k];
+            if(segments.empty()){
+                gridMinX = maxX = a.x;
+                gridMinY = maxY = a.y;
+            }
+            segments.push_back(make_pair(a, b));
+            segmentPolygon.push_back(i);
+            gridMinX = min(gridMinX, min(a.x, b.x)); maxX = max(maxX, max(a.x, b.x));
+            gridMinY = min(gridMinY, min(a.y, b.y)); maxY = max(maxY, max(a.y, b.y));
+        }
+    }
+    stamps.assign(segments.size(), 0);
+    stamp = 0;
+    if(segments.empty()){
+        return;
+    }
+
+    long long span = max((long long)maxX - gridMinX, (long long)maxY - gridMinY) + 1;
+    cellSize = (int)max(1LL, (span + ROUTE_GRID_CELLS - 1) / ROUTE_GRID_CELLS);
+    cellsX = ((long long)maxX - gridMinX) / cellSize + 1;
+    cellsY = ((long long)maxY - gridMinY) / cellSize + 1;
+    cells.resize(cellsX * cellsY);
+    for(int e = 0; e < segments.size(); e++){
+        Node &a = segments[e].first, &b = segments[e].second;
+        int c0 = ((long long)min(a.x, b.x) - gridMinX) / cellSize;
+        int c1 = ((long long)max(a.x, b.x) - gridMinX) / cellSize;
+        int r0 = ((long long)min(a.y, b.y) - gridMinY) / cellSize;
+        int r1 = ((long long)max(a.y, b.y) - gridMinY) / cellSize;
+        for(int r = r0; r <= r1; r++){
+            for(int c = c0; c <= c1; c++){
+                cells[r * cellsX + c].push_back(e);
+            }
+        }
+    }
+}
+
+/*
+  Tests the segment against the edges in the grid cells it passes through.
+  Per column of cells the rows are taken from the y range of the segment
+  over that column, widened by one unit, so no cell it touches is missed.
+*/
+bool RouteGraph::touchesAnyEdge(Node &from, Node &to)
+{
+    if(cells.empty()){
+        return false;
+    }
+    stamp++;
+    long long x0 = min(from.x, to.x), x1 = max(from.x, to.x);
+    long long c0 = (x0 - gridMinX) / cellSize, c1 = (x1 - gridMinX) / cellSize;
+    if(x1 < gridMinX || c0 >= cellsX){
+        return false;
+    }
+    c0 = max(c0, 0LL);
+    c1 = min(c1, (long long)cellsX - 1);
+    for(long long c = c0; c <= c1; c++){
+        double left = max((double)x0, (double)gridMinX + c * cellSize);
+        double right = min((double)x1, (double)gridMinX + (c + 1) * cellSize);
+        double ya, yb;
+        if(from.x == to.x){
+            ya = min(from.y, to.y);
+            yb = max(from.y, to.y);
+        }else{
+            double slope = ((double)to.y - from.y) / ((double)to.x - from.x);
+            ya = from.y + slope * (left - from.x);
+            yb = from.y + slope * (right - from.x);
+            if(ya > yb){
+                swap(ya, yb);
+            }
+        }
+        long long r0 = (long long)floor((ya - 1 - gridMinY) / cellSize);
+        long long r1 = (long long)floor((yb + 1 - gridMinY) / cellSize);
+        r0 = max(r0, 0LL);
+        r1 = min(r1, (long long)cellsY - 1);
+        for(long long r = r0; r <= r1; r++){
+            vector<int> &cell = cells[r * cellsX + c];
+            for(int i = 0; i < cell.size(); i++){
+                int e = cell[i];
+                if(stamps[e] == stamp){
+                    continue;
+                }
+                stamps[e] = stamp;
+                if(touchesEdge(from, to, segments[e].first, segments[e].second)){
+                    return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+/*
+  forbiddenPos uses the truncating crossing test, which only differs from
+  the exact one for edges that cross the row of (x,y) less than one unit
+  to its left or right. For a position in exactly allowed space that is
+  not on an edge, the answer differs if such edges of one polygon come in
+  an odd number.
+*/
+bool RouteGraph::agreesWithServer(int x, int y)
+{
+    if(cells.empty() || y < gridMinY){
+        return true;
+    }
+    long long r = ((long long)y - gridMinY) / cellSize;
+    long long c0 = ((long long)x - 1 - gridMinX) / cellSize;
+    long long c1 = ((long long)x + 1 - gridMinX) / cellSize;
+    if(r >= cellsY || (long long)x + 1 < gridMinX || c0 >= cellsX){
+        return true;
+    }
+    c0 = max(c0, 0LL);
+    c1 = min(c1, (long long)cellsX - 1);
+    stamp++;
+    vector<int> flipped;
+    for(long long c = c0; c <= c1; c++){
+        vector<int> &cell = cells[r * cellsX + c];
+        for(int i = 0; i < cell.size(); i++){
+            int e = cell[i];
+            if(stamps[e] == stamp){
+                continue;
+            }
+            stamps[e] = stamp;
+            Node &prev = segments[e].first, &cur = segments[e].second;
+            if(crossesCompat(cur.x, cur.y, prev.x, prev.y, x, y) != crossesExact(cur.x, cur.y, prev.x, prev.y, x, y)){
+                flipped.push_back(segmentPolygon[e]);
+            }
+        }
+    }
+    sort(flipped.begin(), flipped.end());
+    for(int i = 0; i < flipped.size(); ){
+        int k = i;
+        while(k < flipped.size() && flipped[k] == flipped[i]){
+            k++;
+        }
+        if((k - i) % 2 == 1){
+            return false;
+        }
+        i = k;
+    }
+    return true;
+}
+
+/*
+  A segment that doesn't touch any edge lies in one region. A node that
+  isn't on an edge lies in that region too, so its own classification
+  decides, otherwise the midpoint of the segment is checked. The integer
+  positions along the segment also have to be allowed for forbiddenPos.
+*/
+bool RouteGraph::isVisible(int from, int to)
+{
+    if(touchesAnyEdge(nodes[from], nodes[to])){
+        return false;
+    }
+    bool allowed;
+    if(!onEdge[from]){
+        allowed = exactAllowed[from];
+    }else if(!onEdge[to]){
+        allowed = exactAllowed[to];
+    }else{
+        long long mx2 = (long long)nodes[from].x + nodes[to].x;
+        long long my2 = (long long)nodes[from].y + nodes[to].y;
+        allowed = true;
+        Polygon scratch;
+        for(int i = 0; i < map->numOfPolygons() && allowed; i++){
+            Polygon &poly = map->polygonAt(i, scratch);
+            allowed = isDoubledPosInPoly(poly, mx2, my2) == poly.allowedInside;
+        }
+    }
+    if(!allowed){
+        return false;
+    }
+
+    // both ends are allowed for forbiddenPos already
+    long long dx = (long long)nodes[to].x - nodes[from].x;
+    long long dy = (long long)nodes[to].y - nodes[from].y;
+    long long steps = commonDivisor(llabs(dx), llabs(dy));
+    for(long long k = 1; k < steps; k++){
+        if(!agreesWithServer(nodes[from].x + dx / steps * k, nodes[from].y + dy / steps * k)){
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+  A shortest route only bends around a waypoint if it passes the corner on
+  the outside: both neighbours of the corner lie on the same side of the
+  line towards the other node.
+*/
+bool RouteGraph::isTangent(int node, Node &other)
+{
+    Corner &corner = corners[node];
+    if(!corner.valid){
+        return true;
+    }
+    long long dx = (long long)other.x - corner.vertex.x;
+    long long dy = (long long)other.y - corner.vertex.y;
+    long long a = dx * ((long long)corner.prev.y - corner.vertex.y) - dy * ((long long)corner.prev.x - corner.vertex.x);
+    long long b = dx * ((long long)corner.next.y - corner.vertex.y) - dy * ((long long)corner.next.x - corner.vertex.x);
+    return !((a > 0 && b < 0) || (a < 0 && b > 0));
+}
+
+/*
+  One waypoint per corner that sticks out into allowed space: convex
+  corners of forbidden inside polygons, reflex corners of allowed inside
+  ones. It is put on the first free position around the corner, trying the
+  direction that points away from both edges first.
+*/
+void RouteGraph::addWaypoints(Polygon &poly)
+{
+    int n = poly.numOfNodes;
+    long long area2 = 0;
+    for(int k = 0, j = n-1; k < n; j = k++){
+        area2 += (long long)poly.nodes[j].x * poly.nodes[k].y - (long long)poly.nodes[k].x * poly.nodes[j].y;
+    }
+    int orientation = (area2 > 0) - (area2 < 0);
+
+    for(int k = 0; k < n; k++){
+        Node &vertex = poly.nodes[k];
+        // neighbours, skipping repeated vertices
+        int p = k, q = k;
+        for(int step = 1; step < n && p == k; step++){
+            Node &cand = poly.nodes[(k - step + n) % n];
+            if(cand.x != vertex.x || cand.y != vertex.y){
+                p = (k - step + n) % n;
+            }
+        }
+        for(int step = 1; step < n && q == k; step++){
+            Node &cand = poly.nodes[(k + step) % n];
+            if(cand.x != vertex.x || cand.y != vertex.y){
+                q = (k + step) % n;
+            }
+        }
+        if(p == k || q == k){
+            continue;
+        }
+        Node &prev = poly.nodes[p], &next = poly.nodes[q];
+        long long ax = (long long)vertex.x - prev.x, ay = (long long)vertex.y - prev.y;
+        long long bx = (long long)next.x - vertex.x, by = (long long)next.y - vertex.y;
+        long long turn = ax * by - ay * bx;
+        bool spike = turn == 0 && ax * bx + ay * by < 0;
+        if(turn == 0 && !spike){
+            continue;
+        }
+        int side = (turn > 0) - (turn < 0);
+        bool sticksOut = spike || orientation == 0 ||
+                         (poly.allowedInside ? side == -orientation : side == orientation);
+        if(!sticksOut){
+            continue;
+        }
+
+        double lenA = hypot((double)ax, (double)ay), lenB = hypot((double)bx, (double)by);
+        double wx = ax / lenA - bx / lenB, wy = ay / lenA - by / lenB;
+        if(spike){
+            wx = ax / lenA;
+            wy = ay / lenA;
+        }
+        vector< pair<double, pair<int,int> > > offsets;
+        for(int dx = -1; dx <= 1; dx++){
+            for(int dy = -1; dy <= 1; dy++){
+                if(dx != 0 || dy != 0){
+                    offsets.push_back(make_pair(-(wx * dx + wy * dy) / hypot((double)dx, (double)dy), make_pair(dx, dy)));
+                }
+            }
+        }
+        sort(offsets.begin(), offsets.end());
+        for(int i = 0; i < offsets.size(); i++){
+            struct Node node;
+            node.id = -1;
+            node.x = vertex.x + offsets[i].second.first;
+            node.y = vertex.y + offsets[i].second.second;
+            if(!map->isForbidden(node.x, node.y)){
+                struct Corner corner;
+                corner.valid = true;
+                corner.vertex = vertex;
+                corner.prev = prev;
+                corner.next = next;
+                nodes.push_back(node);
+                corners.push_back(corner);
+                break;
+            }
+        }
+    }
+}
+
+/*
+  Rebuilds the graph from the current state of the map. Markings keep their
+  id in the graph, waypoints get id -1.
+*/
+void RouteGraph::build()
+{
+    nodes.clear();
+    corners.clear();
+    edges.clear();
+
+    for(int i = 0; i < map->markings.size(); i++){
+        Marking &marking = map->markings[i];
+        if(marking.id < 0 || map->isForbidden(marking.x, marking.y)){
+            continue;
+        }
+        struct Node node;
+        node.id = marking.id;
+        node.x = marking.x;
+        node.y = marking.y;
+        struct Corner corner;
+        corner.valid = false;
+        nodes.push_back(node);
+        corners.push_back(corner);
+    }
+    Polygon scratch;
+    for(int i = 0; i < map->numOfPolygons(); i++){
+        addWaypoints(map->polygonAt(i, scratch));
+    }
+
+    buildGrid();
+    onEdge.assign(nodes.size(), false);
+    exactAllowed.assign(nodes.size(), true);
+    for(int i = 0; i < nodes.size(); i++){
+        Node &node = nodes[i];
+        if(!cells.empty() && node.x >= gridMinX && node.y >= gridMinY){
+            long long c = ((long long)node.x - gridMinX) / cellSize;
+            long long r = ((long long)node.y - gridMinY) / cellSize;
+            if(c < cellsX && r < cellsY){
+                vector<int> &cell = cells[r * cellsX + c];
+                for(int k = 0; k < cell.size() && !onEdge[i]; k++){
+                    Node &a = segments[cell[k]].first, &b = segments[cell[k]].second;
+                    onEdge[i] = onSegment(a.x, a.y, b.x, b.y, node.x, node.y);
+                }
+            }
+        }
+        for(int p = 0; p < map->numOfPolygons() && !onEdge[i]; p++){
+            Polygon &poly = map->polygonAt(p, scratch);
+            if(isDoubledPosInPoly(poly, 2LL * node.x, 2LL * node.y) != poly.allowedInside){
+                exactAllowed[i] = false;
+                break;
+            }
+        }
+    }
+
+    edges.resize(nodes.size());
+    for(int i = 0; i < nodes.size(); i++){
+        for(int j = i + 1; j < nodes.size(); j++){
+            if(!isTangent(i, nodes[j]) || !isTangent(j, nodes[i]) || !isVisible(i, j)){
+                continue;
+            }
+            double cost = hypot((double)nodes[i].x - nodes[j].x,
+                                (double)nodes[i].y - nodes[j].y);
+            Edge e1 = { j, cost };
+            Edge e2 = { i, cost };
+            edges[i].push_back(e1);
+            edges[j].push_back(e2);
+        }
+    }
+    builtRevision = map->revision;
+}
+
+int RouteGraph::findMarkingNode(int id)
+{
+    for(int i = 0; i < nodes.size(); i++){
+        if(nodes[i].id == id){
+            return i;
+        }
+    }
+    return -1;
+}
+
+/*
+  Dijkstra between two markings. Returns false if either marking is unknown
+  or lies in forbidden space, or if there is no route between them.
+*/
+bool RouteGraph::shortestRoute(int fromId, int toId, vector<Node> &route, double &length)
+{
+    route.clear();
+    length = -1;
+    if(fromId < 0 || toId < 0){
+        return false;
+    }
+    int from = findMarkingNode(fromId);
+    int to = findMarkingNode(toId);
+    if(from < 0 || to < 0){
+        return false;
+    }
+
+    vector<double> dist(nodes.size(), -1);
+    vector<int> prev(nodes.size(), -1);
+    priority_queue< pair<double,int>, vector< pair<double,int> >, greater< pair<double,int> > > queue;
+    dist[from] = 0;
+    queue.push(make_pair(0.0, from));
+
+    while(!queue.empty()){
+        pair<double,int> top = queue.top();
+        queue.pop();
+        int cur = top.second;
+        if(top.first > dist[cur]){
+            continue;
+        }
+        if(cur == to){
+            break;
+        }
+        for(int i = 0; i < edges[cur].size(); i++){
+            Edge &e = edges[cur][i];
+            double d = dist[cur] + e.cost;
+            if(dist[e.to] < 0 || d < dist[e.to]){
+                dist[e.to] = d;
+                prev[e.to] = cur;
+                queue.push(make_pair(d, e.to));
+            }
+        }
+    }
+
+    if(dist[to] < 0){
+        return false;
+    }
+    for(int cur = to; cur != -1; cur = prev[cur]){
+        route.push_back(nodes[cur]);
+    }
+    reverse(route.begin(), route.end());
+    for(int i = 0; i < route.size(); i++){
+        route[i].id = i;
+    }
+    length = dist[to];
+    return true;
+}
+
+RouteCache::RouteCache(Map *map, int capacity) : graph(map)
+{
+    this->map = map;
+    this->capacity = capacity;
+    hits = 0;
+    misses = 0;
+}
+
+void RouteCache::invalidate()
+{
+    lru.clear();
+    index.clear();
+}
+
+void RouteCache::rebuild()
+{
+    graph.build();
+    invalidate();
+}
+
+int RouteCache::size()
+{
+    return lru.size();
+}
+
+bool RouteCache::getRoute(int fromId, int toId, vector<Node> &route, double &length)
+{
+    lock_guard<mutex> guard(lock);
+    if(graph.builtRevision != map->revision){
+        rebuild();
+    }
+
+    long long key = ((long long)fromId << 32) | (unsigned int)toId;
+    unordered_map<long long, RouteList::iterator>::iterator it = index.find(key);
+    if(it != index.end()){
+        hits++;
+        lru.splice(lru.begin(), lru, it->second);
+        Route &cached = it->second->second;
+        route = cached.nodes;
+        length = cached.length;
+        return cached.found;
+    }
+
+    misses++;
+    Route result;
+    result.found = graph.shortestRoute(fromId, toId, result.nodes, result.length);
+    route = result.nodes;
+    length = result.length;
+
+    if(capacity > 0){
+        lru.push_front(make_pair(key, result));
+        index[key] = lru.begin();
+        if(lru.size() > capacity){
+            index.erase(lru.back().first);
+            lru.pop_back();
+        }
+    }
+    return result.found;
+}
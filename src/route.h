@@ -0,0 +1,130 @@
+/*
+Copyright (c) 2017, Robert Krook
+Copyright (c) 2017, Erik Almblad
+Copyright (c) 2017, Hawre Aziz
+Copyright (c) 2017, Alexander Branzell
+Copyright (c) 2017, Mattias Eriksson
+Copyright (c) 2017, Carl Hjerpe
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the Chalmers University of Technology nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef ROUTE_H
+#define ROUTE_H
+
+#include <list>
+#include <unordered_map>
+#include <mutex>
+#include "map.h"
+
+using namespace std;
+
+#define ROUTE_GRID_CELLS 64
+
+/*
+  Visibility graph over the allowed space of a map. The graph nodes are the
+  markings plus one waypoint next to every polygon vertex a shortest route
+  can bend around (corners that stick out into allowed space), moved one
+  step away from the corner so it ends up in allowed space. Two nodes are
+  connected if the straight segment between them never leaves the allowed
+  space and passes its waypoints on the outside of the corners. Edges are
+  kept in a uniform grid so that a segment is only tested against the edges
+  near it.
+*/
+class RouteGraph{
+    public:
+        RouteGraph(Map *map);
+        void build();
+        bool shortestRoute(int fromId, int toId, vector<Node> &route, double &length);
+        unsigned long builtRevision;
+        int numOfNodes();
+        int numOfEdges();
+
+    private:
+        struct Edge
+        {
+            int to;
+            double cost;
+        };
+        // polygon corner a waypoint was made for, markings have none
+        struct Corner
+        {
+            bool valid;
+            Node vertex, prev, next;
+        };
+        Map *map;
+        vector<Node> nodes;
+        vector<Corner> corners;
+        // whether a node lies on a polygon edge and, if not, whether it is
+        // in allowed space by the exact crossing test
+        vector<bool> onEdge, exactAllowed;
+        vector< vector<Edge> > edges;
+        // grid of polygon edges (previous node, current node) and the
+        // polygon each one belongs to
+        vector< pair<Node, Node> > segments;
+        vector<int> segmentPolygon;
+        vector< vector<int> > cells;
+        vector<unsigned int> stamps;
+        unsigned int stamp;
+        int gridMinX, gridMinY, cellSize, cellsX, cellsY;
+        void buildGrid();
+        void addWaypoints(Polygon &poly);
+        bool isTangent(int node, Node &other);
+        bool touchesAnyEdge(Node &from, Node &to);
+        bool isVisible(int from, int to);
+        bool agreesWithServer(int x, int y);
+        int findMarkingNode(int id);
+};
+
+/*
+  LRU cache of marking to marking routes on top of a RouteGraph. The graph
+  and the cache are thrown away as soon as the map revision changes.
+  getRoute may be called from several threads.
+*/
+class RouteCache{
+    public:
+        RouteCache(Map *map, int capacity);
+        bool getRoute(int fromId, int toId, vector<Node> &route, double &length);
+        void invalidate();
+        void rebuild();
+        int size();
+        RouteGraph graph;
+        unsigned long hits, misses;
+
+    private:
+        struct Route
+        {
+            bool found;
+            double length;
+            vector<Node> nodes;
+        };
+        typedef list< pair<long long, Route> > RouteList;
+        Map *map;
+        int capacity;
+        RouteList lru;
+        mutex lock;
+        unordered_map<long long, RouteList::iterator> index;
+};
+
+#endif
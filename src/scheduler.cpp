@@ -0,0 +1,157 @@
+/*
+Copyright (c) 2017, Robert Krook
+Copyright (c) 2017, Erik Almblad
+Copyright (c) 2017, Hawre Aziz
+Copyright (c) 2017, Alexander Branzell
+Copyright (c) 2017, Mattias Eriksson
+Copyright (c) 2017, Carl Hjerpe
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the Chalmers University of Technology nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "scheduler.h"
+
+using namespace std;
+
+atomic<unsigned long> SchedSlot::expiredUnscheduled(0);
+
+bool Scheduler::Ranking::operator()(const Ticket *a, const Ticket *b) const
+{
+    if(a->priority != b->priority){
+        return a->priority > b->priority;
+    }
+    if(a->deadline != b->deadline){
+        return a->deadline < b->deadline;
+    }
+    return a->seq < b->seq;
+}
+
+Scheduler::Scheduler(int slots, int queueLimit)
+{
+    this->slots = max(1, slots);
+    this->queueLimit = max(0, queueLimit);
+    busy = 0;
+    maxDepth = 0;
+    seq = 0;
+    admitted = 0;
+    expired = 0;
+    rejected = 0;
+    evicted = 0;
+}
+
+/*
+  Blocks until the call may run. timeout is in seconds from now, 0 means
+  the deadline has already passed and any negative value such as
+  SCHED_NO_DEADLINE waits for as long as it takes. Returns SCHED_ADMITTED,
+  in which case release() has to be called, SCHED_EXPIRED or
+  SCHED_REJECTED.
+*/
+int Scheduler::admit(int priority, double timeout)
+{
+    chrono::steady_clock::time_point now = chrono::steady_clock::now();
+    struct Ticket ticket;
+    ticket.priority = priority;
+    ticket.deadline = (timeout < 0) ? chrono::steady_clock::time_point::max()
+                                    : now + chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(timeout));
+    ticket.evicted = false;
+
+    unique_lock<mutex> guard(lock);
+    ticket.seq = seq++;
+    if(timeout == 0){
+        expired++;
+        return SCHED_EXPIRED;
+    }
+    if(waiting.empty() && busy < slots){
+        busy++;
+        admitted++;
+        return SCHED_ADMITTED;
+    }
+    if(waiting.size() >= queueLimit){
+        if(waiting.empty() || !Ranking()(&ticket, *waiting.rbegin())){
+            rejected++;
+            return SCHED_REJECTED;
+        }
+        Ticket *last = *waiting.rbegin();
+        waiting.erase(last);
+        last->evicted = true;
+        evicted++;
+        changed.notify_all();
+    }
+    waiting.insert(&ticket);
+    maxDepth = max(maxDepth, (int)waiting.size());
+
+    while(true){
+        if(ticket.evicted){
+            return SCHED_REJECTED;
+        }
+        if(busy < slots && *waiting.begin() == &ticket){
+            waiting.erase(&ticket);
+            busy++;
+            admitted++;
+            // the next one in line may fit in another free slot
+            changed.notify_all();
+            return SCHED_ADMITTED;
+        }
+        if(timeout < 0){
+            changed.wait(guard);
+        }else if(changed.wait_until(guard, ticket.deadline) == cv_status::timeout &&
+                 !ticket.evicted && chrono::steady_clock::now() >= ticket.deadline){
+            waiting.erase(&ticket);
+            expired++;
+            changed.notify_all();
+            return SCHED_EXPIRED;
+        }
+    }
+}
+
+void Scheduler::release()
+{
+    lock_guard<mutex> guard(lock);
+    busy--;
+    changed.notify_all();
+}
+
+void Scheduler::getStats(SchedStats &stats)
+{
+    lock_guard<mutex> guard(lock);
+    stats.depth = waiting.size();
+    stats.maxDepth = maxDepth;
+    stats.busy = busy;
+    stats.slots = slots;
+    stats.admitted = admitted;
+    stats.expired = expired;
+    stats.rejected = rejected;
+    stats.evicted = evicted;
+    stats.depthByPriority.clear();
+    for(set<Ticket *, Ranking>::iterator it = waiting.begin(); it != waiting.end(); it++){
+        int priority = (*it)->priority;
+        if(priority < 0){
+            continue;
+        }
+        if(priority >= stats.depthByPriority.size()){
+            stats.depthByPriority.resize(priority + 1, 0);
+        }
+        stats.depthByPriority[priority]++;
+    }
+}
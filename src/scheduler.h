@@ -0,0 +1,133 @@
+/*
+Copyright (c) 2017, Robert Krook
+Copyright (c) 2017, Erik Almblad
+Copyright (c) 2017, Hawre Aziz
+Copyright (c) 2017, Alexander Branzell
+Copyright (c) 2017, Mattias Eriksson
+Copyright (c) 2017, Carl Hjerpe
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the Chalmers University of Technology nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <set>
+#include <vector>
+#include <atomic>
+#include "map.h"
+
+#define SCHED_ADMITTED  0
+#define SCHED_EXPIRED   1
+#define SCHED_REJECTED  2
+
+#define SCHED_NO_DEADLINE (-1.0)
+
+using namespace std;
+
+/*
+  Counters and queue depth at one point in time, depthByPriority holds the
+  number of waiting calls for every priority from 0 up to the highest one
+  waiting.
+*/
+struct SchedStats
+{
+    int depth, maxDepth, busy, slots;
+    unsigned long admitted, expired, rejected, evicted;
+    vector<int> depthByPriority;
+};
+
+/*
+  Admission control for the service handlers. Every handler thread calls
+  admit() before doing its work and release() after. At most `slots` calls
+  run at a time, the others wait ordered by priority (higher first), then
+  by deadline (earlier first), then by arrival. A call whose deadline
+  passes while waiting is shed. When queueLimit calls are already waiting
+  a new call takes the place of the lowest ranked one if it ranks higher,
+  otherwise it is rejected.
+*/
+class Scheduler{
+    public:
+        Scheduler(int slots, int queueLimit);
+        int admit(int priority, double timeout);
+        void release();
+        void getStats(SchedStats &stats);
+
+    private:
+        struct Ticket
+        {
+            int priority;
+            chrono::steady_clock::time_point deadline;
+            unsigned long seq;
+            bool evicted;
+        };
+        struct Ranking
+        {
+            bool operator()(const Ticket *a, const Ticket *b) const;
+        };
+        int slots, queueLimit, busy, maxDepth;
+        unsigned long seq;
+        unsigned long admitted, expired, rejected, evicted;
+        set<Ticket *, Ranking> waiting;
+        mutex lock;
+        condition_variable changed;
+};
+
+/*
+  Holds a slot for the lifetime of the object. Without a scheduler every
+  call is admitted right away, except one whose deadline has already
+  passed, which is shed and counted in expiredUnscheduled.
+*/
+class SchedSlot{
+    public:
+        SchedSlot(Scheduler *scheduler, int priority, double timeout)
+        {
+            this->scheduler = scheduler;
+            if(scheduler != NULL){
+                result = scheduler->admit(priority, timeout);
+            }else if(timeout == 0){
+                expiredUnscheduled++;
+                result = SCHED_EXPIRED;
+            }else{
+                result = SCHED_ADMITTED;
+            }
+        }
+        ~SchedSlot()
+        {
+            if(result == SCHED_ADMITTED && scheduler != NULL){
+                scheduler->release();
+            }
+        }
+        bool admitted() { return result == SCHED_ADMITTED; }
+        int result;
+        static atomic<unsigned long> expiredUnscheduled;
+
+    private:
+        Scheduler *scheduler;
+};
+
+#endif
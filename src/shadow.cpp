@@ -0,0 +1,144 @@
+/*
+Copyright (c) 2017, Robert Krook
+Copyright (c) 2017, Erik Almblad
+Copyright (c) 2017, Hawre Aziz
+Copyright (c) 2017, Alexander Branzell
+Copyright (c) 2017, Mattias Eriksson
+Copyright (c) 2017, Carl Hjerpe
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the Chalmers University of Technology nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <math.h>
+#include "shadow.h"
+
+using namespace std;
+
+/*
+  sampleRate is the share of submitted answers that gets checked, it is
+  turned into "every n:th" so that sampling costs one atomic increment.
+*/
+ShadowVerifier::ShadowVerifier(Map *reference, double sampleRate, int queueLimit, int maxReproducers)
+    : submitted(0), checked(0), mismatches(0), dropped(0)
+{
+    this->reference = reference;
+    this->queueLimit = queueLimit;
+    this->maxReproducers = maxReproducers;
+    period = (sampleRate > 0) ? (unsigned long)max(1.0, round(1.0 / sampleRate)) : 0;
+    running = false;
+    busy = 0;
+}
+
+ShadowVerifier::~ShadowVerifier()
+{
+    stop();
+}
+
+void ShadowVerifier::start()
+{
+    lock_guard<mutex> guard(lock);
+    if(running || period == 0){
+        return;
+    }
+    running = true;
+    worker = thread(&ShadowVerifier::run, this);
+}
+
+void ShadowVerifier::stop()
+{
+    {
+        lock_guard<mutex> guard(lock);
+        running = false;
+    }
+    wakeUp.notify_all();
+    if(worker.joinable()){
+        worker.join();
+    }
+}
+
+void ShadowVerifier::submit(int x, int y, bool answer)
+{
+    if(period == 0 || submitted++ % period != 0){
+        return;
+    }
+    {
+        lock_guard<mutex> guard(lock);
+        if(!running || queue.size() >= queueLimit){
+            dropped++;
+            return;
+        }
+        Check check = { x, y, answer };
+        queue.push_back(check);
+    }
+    wakeUp.notify_one();
+}
+
+/*
+  Waits until every queued check has been done.
+*/
+void ShadowVerifier::drain()
+{
+    unique_lock<mutex> guard(lock);
+    idle.wait(guard, [this]{ return !running || (queue.empty() && busy == 0); });
+}
+
+void ShadowVerifier::getReproducers(vector<Reproducer> &out)
+{
+    lock_guard<mutex> guard(lock);
+    out = reproducers;
+}
+
+void ShadowVerifier::run()
+{
+    unique_lock<mutex> guard(lock);
+    while(true){
+        wakeUp.wait(guard, [this]{ return !running || !queue.empty(); });
+        if(!running){
+            break;
+        }
+        Check check = queue.front();
+        queue.pop_front();
+        busy++;
+        guard.unlock();
+
+        bool expected = reference->isForbidden(check.x, check.y);
+        checked++;
+
+        guard.lock();
+        busy--;
+        if(expected != check.answer){
+            mismatches++;
+            cerr << "Shadow mismatch at (" << check.x << "," << check.y << "): live "
+                 << check.answer << " reference " << expected << endl;
+            if(reproducers.size() < maxReproducers){
+                Reproducer r = { check.x, check.y, check.answer, expected };
+                reproducers.push_back(r);
+            }
+        }
+        if(queue.empty()){
+            idle.notify_all();
+        }
+    }
+    idle.notify_all();
+}
@@ -0,0 +1,89 @@
+/*
+Copyright (c) 2017, Robert Krook
+Copyright (c) 2017, Erik Almblad
+Copyright (c) 2017, Hawre Aziz
+Copyright (c) 2017, Alexander Branzell
+Copyright (c) 2017, Mattias Eriksson
+Copyright (c) 2017, Carl Hjerpe
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the Chalmers University of Technology nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef SHADOW_H
+#define SHADOW_H
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <atomic>
+#include "map.h"
+
+using namespace std;
+
+/*
+  A point where the live answer and Map::isForbidden disagreed.
+*/
+struct Reproducer
+{
+    int x, y;
+    bool live, reference;
+};
+
+/*
+  Re-checks a sample of the forbiddenPos answers given by a fast path
+  against the reference crossing test in Map, on its own thread. submit()
+  never blocks, checks that don't fit in the queue are dropped and counted.
+*/
+class ShadowVerifier{
+    public:
+        ShadowVerifier(Map *reference, double sampleRate, int queueLimit, int maxReproducers);
+        ~ShadowVerifier();
+        void start();
+        void stop();
+        void submit(int x, int y, bool answer);
+        void drain();
+        void getReproducers(vector<Reproducer> &out);
+        atomic<unsigned long> submitted, checked, mismatches, dropped;
+
+    private:
+        struct Check
+        {
+            int x, y;
+            bool answer;
+        };
+        Map *reference;
+        unsigned long period;
+        int queueLimit, maxReproducers;
+        bool running;
+        int busy;
+        deque<Check> queue;
+        vector<Reproducer> reproducers;
+        mutex lock;
+        condition_variable wakeUp, idle;
+        thread worker;
+        void run();
+};
+
+#endif
@@ -0,0 +1,181 @@
+/*
+Copyright (c) 2017, Robert Krook
+Copyright (c) 2017, Erik Almblad
+Copyright (c) 2017, Hawre Aziz
+Copyright (c) 2017, Alexander Branzell
+Copyright (c) 2017, Mattias Eriksson
+Copyright (c) 2017, Carl Hjerpe
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the Chalmers University of Technology nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "zones.h"
+
+using namespace std;
+
+ZoneLayer::ZoneLayer(Map *map)
+{
+    this->map = map;
+    builtRevision = NOT_BUILT;
+    minX = minY = 0;
+    cellSize = 1;
+    cellsX = cellsY = 0;
+    outsideForbidden = false;
+    numOfShapes = 0;
+}
+
+/*
+  Only bounding boxes and attributes are kept, the shapes themselves are
+  tested where the map keeps them, compacted or not.
+*/
+void ZoneLayer::build()
+{
+    boxes.clear();
+    forbidding.clear();
+    allowedInside.clear();
+    attributes.clear();
+    Polygon scratch;
+    for(int i = 0; i < map->numOfPolygons(); i++){
+        Polygon &poly = map->polygonAt(i, scratch);
+        boxes.push_back(boundingBox(poly));
+        forbidding.push_back(true);
+        allowedInside.push_back(poly.allowedInside);
+        attributes.push_back(poly.attributes);
+    }
+    for(int i = 0; i < map->zones.size(); i++){
+        boxes.push_back(boundingBox(map->zones[i]));
+        forbidding.push_back(false);
+        allowedInside.push_back(map->zones[i].allowedInside);
+        attributes.push_back(map->zones[i].attributes);
+    }
+    numOfShapes = boxes.size();
+    cells.clear();
+    cellsX = cellsY = 0;
+    minX = minY = 0;
+    cellSize = 1;
+    builtRevision = map->revision;
+
+    // outside every bounding box only allowed inside polygons count
+    outsideForbidden = false;
+    bool empty = true;
+    int maxX = 0, maxY = 0;
+    for(int s = 0; s < numOfShapes; s++){
+        outsideForbidden = outsideForbidden || (forbidding[s] && allowedInside[s]);
+        BBox &box = boxes[s];
+        if(box.empty){
+            continue;
+        }
+        if(empty){
+            minX = box.minX; minY = box.minY; maxX = box.maxX; maxY = box.maxY;
+            empty = false;
+        }
+        minX = min(minX, box.minX); maxX = max(maxX, box.maxX);
+        minY = min(minY, box.minY); maxY = max(maxY, box.maxY);
+    }
+    if(empty){
+        return;
+    }
+
+    long long span = max((long long)maxX - minX, (long long)maxY - minY) + 1;
+    cellSize = (int)max(1LL, (span + ZONE_GRID_CELLS - 1) / ZONE_GRID_CELLS);
+    cellsX = ((long long)maxX - minX) / cellSize + 1;
+    cellsY = ((long long)maxY - minY) / cellSize + 1;
+    cells.resize(cellsX * cellsY);
+
+    for(int cy = 0; cy < cellsY; cy++){
+        for(int cx = 0; cx < cellsX; cx++){
+            Cell &cell = cells[cy * cellsX + cx];
+            long long cellX0 = minX + (long long)cx * cellSize, cellX1 = cellX0 + cellSize - 1;
+            long long cellY0 = minY + (long long)cy * cellSize, cellY1 = cellY0 + cellSize - 1;
+            cell.baseForbidden = false;
+            for(int s = 0; s < numOfShapes; s++){
+                BBox &box = boxes[s];
+                bool overlaps = !box.empty && box.minX <= cellX1 && box.maxX >= cellX0 &&
+                                box.minY <= cellY1 && box.maxY >= cellY0;
+                if(overlaps){
+                    cell.shapes.push_back(s);
+                }else if(forbidding[s] && allowedInside[s]){
+                    cell.baseForbidden = true;
+                }
+            }
+        }
+    }
+}
+
+bool ZoneLayer::isPosInShape(int s, int x, int y)
+{
+    if(!boxes[s].contains(x, y)){
+        return false;
+    }
+    if(forbidding[s]){
+        return map->isPosInPolygonAt(s, x, y);
+    }
+    return map->isPosInPoly(&map->zones[s - map->numOfPolygons()], x, y);
+}
+
+void ZoneLayer::addShape(int s, ZoneAttributes &result)
+{
+    ZoneAttributes &attr = attributes[s];
+    if(attr.flags & ZONE_SPEED_LIMIT){
+        if(!(result.flags & ZONE_SPEED_LIMIT) || attr.speedLimit < result.speedLimit){
+            result.speedLimit = attr.speedLimit;
+        }
+    }
+    if((attr.flags & ZONE_ONE_WAY) && !(result.flags & ZONE_ONE_WAY)){
+        result.heading = attr.heading;
+    }
+    result.flags |= attr.flags;
+}
+
+/*
+  ZONE_FORBIDDEN in result.flags is the same answer as Map::isForbidden.
+*/
+void ZoneLayer::query(int x, int y, ZoneAttributes &result)
+{
+    if(builtRevision != map->revision){
+        build();
+    }
+    result = ZoneAttributes();
+    if(cells.empty() || x < minX || y < minY ||
+       ((long long)x - minX) / cellSize >= cellsX || ((long long)y - minY) / cellSize >= cellsY){
+        if(outsideForbidden){
+            result.flags |= ZONE_FORBIDDEN;
+        }
+        return;
+    }
+    Cell &cell = cells[(((long long)y - minY) / cellSize) * cellsX + ((long long)x - minX) / cellSize];
+    if(cell.baseForbidden){
+        result.flags |= ZONE_FORBIDDEN;
+    }
+    for(int i = 0; i < cell.shapes.size(); i++){
+        int s = cell.shapes[i];
+        bool inside = isPosInShape(s, x, y);
+        if(forbidding[s] && inside != allowedInside[s]){
+            result.flags |= ZONE_FORBIDDEN;
+        }
+        if(inside){
+            addShape(s, result);
+        }
+    }
+}
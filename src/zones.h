@@ -0,0 +1,78 @@
+/*
+Copyright (c) 2017, Robert Krook
+Copyright (c) 2017, Erik Almblad
+Copyright (c) 2017, Hawre Aziz
+Copyright (c) 2017, Alexander Branzell
+Copyright (c) 2017, Mattias Eriksson
+Copyright (c) 2017, Carl Hjerpe
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of the Chalmers University of Technology nor the
+      names of its contributors may be used to endorse or promote products
+      derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef ZONES_H
+#define ZONES_H
+
+#include "map.h"
+
+#define ZONE_GRID_CELLS 64
+
+using namespace std;
+
+/*
+  Answers the forbidden bit and the zone attributes at a position in one
+  pass. Map polygons and attribute zones are kept together in a uniform
+  grid, every cell lists the shapes whose bounding box overlaps it, and
+  every listed shape is tested once. Overlapping zones combine: flags are
+  or:ed, the lowest speed limit wins and the heading comes from the first
+  one way zone in file order, map polygons before zones.
+*/
+class ZoneLayer{
+    public:
+        ZoneLayer(Map *map);
+        void build();
+        void query(int x, int y, ZoneAttributes &result);
+        unsigned long builtRevision;
+
+    private:
+        struct Cell
+        {
+            bool baseForbidden;
+            vector<int> shapes;
+        };
+        Map *map;
+        // shapes are the map polygons in polygonAt order, then the zones.
+        // Per shape its bounding box, whether it takes part in the
+        // forbidden test, whether it is allowed inside and its attributes
+        int numOfShapes;
+        vector<BBox> boxes;
+        vector<bool> forbidding, allowedInside;
+        vector<ZoneAttributes> attributes;
+        vector<Cell> cells;
+        int minX, minY, cellSize, cellsX, cellsY;
+        bool outsideForbidden;
+        bool isPosInShape(int s, int x, int y);
+        void addShape(int s, ZoneAttributes &result);
+};
+
+#endif
@@ -1,2 +1,2 @@
-g++ -o test testMapServer.cpp ../src/map.cpp -std=gnu++11
+g++ -o test testMapServer.cpp ../src/map.cpp ../src/compact.cpp ../src/route.cpp ../src/footprint.cpp ../src/raster.cpp ../src/normalize.cpp ../src/mapSocket.cpp ../src/queryLog.cpp ../src/shadow.cpp ../src/engine.cpp ../src/scheduler.cpp ../src/zones.cpp -std=gnu++11 -pthread
 ./test
@@ -30,7 +30,24 @@ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
 SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
+#include <climits>
+#include <math.h>
 #include "../src/map.h"
+#include "../src/route.h"
+#include "../src/footprint.h"
+#include "../src/raster.h"
+#include "../src/normalize.h"
+#include "../src/mapSocket.h"
+#include "../src/queryLog.h"
+#include "../src/shadow.h"
+#include "../src/engine.h"
+#include "../src/scheduler.h"
+#include "../src/zones.h"
+#include <thread>
+#include <chrono>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <string.h>
 using namespace std;
 Map m;
 
@@ -337,6 +354,857 @@ bool testMultipleGet() {
     return (calcx1 == mx && calcy1 == my && calcx2 == m2x && calcy2 == m2y);
     
 }
+/* ------------------------------------------------------------------ */
+/* Tests on routes */
+/* every integer position on the segment a-b is allowed by isForbidden */
+bool segmentAllowed(Map &m, Node &a, Node &b) {
+    int dx = b.x - a.x, dy = b.y - a.y;
+    int steps = max(abs(dx), abs(dy));
+    if(steps == 0) {
+        return !m.isForbidden(a.x, a.y);
+    }
+    for(int k = 0; k <= steps; k++) {
+        if((long long)dx * k % steps == 0 && (long long)dy * k % steps == 0 &&
+           m.isForbidden(a.x + (long long)dx * k / steps, a.y + (long long)dy * k / steps)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool testRouteAroundWall() {
+    Map rm;
+    rm.load("route.db");
+    RouteCache cache(&rm, 4);
+
+    vector<Node> route;
+    double length;
+    if(!cache.getRoute(1, 2, route, length)) {
+        return false;
+    }
+    bool endsGood = route.front().x == 2  && route.front().y == 15 &&
+                    route.back().x  == 18 && route.back().y  == 15;
+    bool allowed = true;
+    for(int i = 0; i + 1 < route.size(); i++) {
+        allowed = allowed && segmentAllowed(rm, route[i], route[i+1]);
+    }
+    return endsGood && allowed && route.size() > 2 && length > 16;
+}
+
+bool testRouteLatticeAllowed() {
+    // a random map where the exact visibility test let a route pass
+    // positions forbiddenPos reports as forbidden
+    Map rm;
+    rm.load("routeLattice.db");
+    RouteCache cache(&rm, 4);
+
+    vector<Node> route;
+    double length;
+    if(!cache.getRoute(3, 7, route, length)) {
+        return false;
+    }
+    for(int i = 0; i + 1 < route.size(); i++) {
+        if(!segmentAllowed(rm, route[i], route[i+1])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool testRouteForbiddenMarking() {
+    Map rm;
+    rm.load("route.db");
+    RouteCache cache(&rm, 4);
+
+    vector<Node> route;
+    double length;
+    return !cache.getRoute(1, 3, route, length) && !cache.getRoute(1, 42, route, length);
+}
+
+bool testRouteCacheInvalidation() {
+    Map rm;
+    rm.load("route.db");
+    RouteCache cache(&rm, 4);
+
+    vector<Node> route;
+    double length;
+    cache.getRoute(1, 2, route, length);
+    cache.getRoute(1, 2, route, length);
+    bool hit = cache.hits == 1 && cache.misses == 1;
+
+    rm.polygons.pop_back();
+    rm.mapChanged();
+    bool found = cache.getRoute(1, 2, route, length);
+    return hit && found && cache.misses == 2 && route.size() == 2 && assertDoubleEquals(length, 16);
+}
+
+/*
+  Only the corners of the wall get a waypoint, the corners of the allowed
+  area never have a route bend around them
+*/
+bool testRouteGraphWaypoints() {
+    Map rm;
+    rm.load("route.db");
+    RouteGraph graph(&rm);
+    graph.build();
+    return graph.numOfNodes() == 6;
+}
+
+/* ------------------------------------------------------------------ */
+/* Tests on footprints */
+bool createFootprints() {
+    Map fm;
+    fm.load("footprint.db");
+    if(fm.footprints.size() != 2) {
+        return false;
+    }
+    Footprint &rect = fm.footprints[0], &circle = fm.footprints[1];
+    return rect.id == 1 && !rect.circle && rect.halfWidth == 2 && rect.halfHeight == 1 &&
+           circle.id == 2 && circle.circle && circle.radius == 3;
+}
+
+bool testFootprintForbidden() {
+    Map fm;
+    fm.load("footprint.db");
+    FootprintZones zones(&fm);
+
+    bool nearObstacle, nearWall, free, pointNear, pointWall;
+    zones.isFootprintForbidden(6, 10, 1, nearObstacle);
+    zones.isFootprintForbidden(1, 10, 1, nearWall);
+    zones.isFootprintForbidden(10, 4, 1, free);
+    pointNear = fm.isForbidden(6, 10);
+    pointWall = fm.isForbidden(1, 10);
+    return nearObstacle && nearWall && !free && !pointNear && !pointWall;
+}
+
+bool testFootprintUnknownClass() {
+    Map fm;
+    fm.load("footprint.db");
+    FootprintZones zones(&fm);
+
+    bool b = false;
+    bool known = zones.isFootprintForbidden(10, 4, 7, b);
+    return !known && b;
+}
+
+bool testFootprintConcave() {
+    Map um;
+    um.load("uslot.db");
+    FootprintZones zones(&um);
+
+    // the slot is 4 wide, a robot of radius 4 fits nowhere in or above it
+    bool inSlot, topOfSlot, aboveSlot, farAbove;
+    zones.isFootprintForbidden(15, 10, 1, inSlot);
+    zones.isFootprintForbidden(15, 18, 1, topOfSlot);
+    zones.isFootprintForbidden(15, 22, 1, aboveSlot);
+    zones.isFootprintForbidden(15, 30, 1, farAbove);
+    return inSlot && topOfSlot && aboveSlot && !farAbove;
+}
+
+bool testFootprintDeflateVanishingEdge() {
+    Map cm;
+    cm.load("chamfer.db");
+    FootprintZones zones(&cm);
+
+    // the short chamfer edge vanishes when deflated by 10, every position
+    // reported safe must keep the whole circle inside the polygon
+    for(int y = -5; y <= 105; y++) {
+        for(int x = -5; x <= 105; x++) {
+            bool b;
+            zones.isFootprintForbidden(x, y, 1, b);
+            bool fits = x >= 10 && y >= 10 && x <= 90 && y <= 90 && (199 - x - y) / sqrt(2.0) >= 10;
+            if(!b && !fits) {
+                return false;
+            }
+        }
+    }
+    bool corner;
+    zones.isFootprintForbidden(89, 94, 1, corner);
+    return corner;
+}
+
+/* ------------------------------------------------------------------ */
+/* Tests on the forbidden raster */
+bool testRasterMatchesMap() {
+    Map rm;
+    rm.load("route.db");
+    ForbiddenRaster raster(&rm, 1000000);
+    raster.build();
+
+    for(int y = -3; y <= 23; y++) {
+        for(int x = -3; x <= 23; x++) {
+            if(raster.isForbidden(x, y) != rm.isForbidden(x, y)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool testRegionQuery() {
+    Map rm;
+    rm.load("route.db");
+    ForbiddenRaster raster(&rm, 1000000);
+
+    long long forbidden, total, expected = 0;
+    raster.regionQuery(15, -5, 5, 25, forbidden, total);
+    for(int y = -5; y <= 25; y++) {
+        for(int x = 5; x <= 15; x++) {
+            expected += rm.isForbidden(x, y);
+        }
+    }
+    return forbidden == expected && total == 11 * 31;
+}
+
+bool testRegionQueryTooLarge() {
+    Map rm;
+    rm.load("route.db");
+    ForbiddenRaster raster(&rm, 10);
+
+    long long forbidden, total, small, smallTotal, far, farTotal, huge, hugeTotal;
+    raster.regionQuery(9, 9, 10, 10, forbidden, total);
+    raster.regionQuery(1, 1, 2, 2, small, smallTotal);
+    // only the part inside the map is tested, the rest is counted
+    bool farOk = raster.regionQuery(-2000000000, 9, 1, 10, far, farTotal);
+    bool hugeOk = raster.regionQuery(INT_MIN, INT_MIN, INT_MAX, INT_MAX, huge, hugeTotal);
+    return !raster.build() && forbidden == 4 && total == 4 && small == 0 &&
+           farOk && farTotal == 2000000002LL * 2 && !hugeOk &&
+           far == farTotal - 4 + rm.isForbidden(0, 9) + rm.isForbidden(1, 9) + rm.isForbidden(0, 10) + rm.isForbidden(1, 10);
+}
+
+/* ------------------------------------------------------------------ */
+/* Tests on map normalization */
+bool testNormalizeRedundant() {
+    Map nm;
+    nm.load("redundantPoly.db");
+    MapNormalizer normalizer(&nm);
+    normalizer.normalize(0);
+
+    Polygon &poly = nm.polygons[0];
+    long long area = 0;
+    for(int i = 0, j = poly.numOfNodes-1; i < poly.numOfNodes; j = i++) {
+        area += (long long)poly.nodes[j].x * poly.nodes[i].y - (long long)poly.nodes[i].x * poly.nodes[j].y;
+    }
+    return poly.numOfNodes == 4 && poly.nodes.size() == 4 && area > 0 &&
+           normalizer.duplicates == 2 && normalizer.collinear == 2 && normalizer.reversed == 1;
+}
+
+bool testNormalizeDegenerate() {
+    Map nm;
+    nm.load("goodPoly.db");
+    nm.polygons[0].allowedInside = false;
+    MapNormalizer normalizer(&nm);
+    normalizer.normalize(0);
+    return normalizer.degenerate.size() == 1 && nm.polygons[0].numOfNodes == 3;
+}
+
+bool testNormalizeSelfIntersecting() {
+    Map nm;
+    nm.load("redundantPoly.db");
+    MapNormalizer normalizer(&nm);
+    normalizer.normalize(0);
+    return normalizer.selfIntersecting.size() == 1 && normalizer.selfIntersecting[0] == 1;
+}
+
+bool testSimplifyGrowsForbidden() {
+    Map before, after;
+    before.load("redundantPoly.db");
+    after.load("redundantPoly.db");
+    before.polygons.erase(before.polygons.begin() + 1);
+    after.polygons.erase(after.polygons.begin() + 1);
+    MapNormalizer normalizer(&after);
+    normalizer.normalize(1.5);
+
+    for(int y = -2; y <= 12; y++) {
+        for(int x = -2; x <= 12; x++) {
+            if(before.isForbidden(x, y) && !after.isForbidden(x, y)) {
+                return false;
+            }
+        }
+    }
+    return normalizer.simplified == 1 && after.polygons[1].numOfNodes == 4;
+}
+
+bool testSimplifyGrowsForbiddenStars() {
+    // random star shaped polygons, simplified or not, answered by the
+    // server's own crossing test
+    Map plain, simple;
+    unsigned int seed = 12345;
+    for(int t = 0; t < 300; t++) {
+        Polygon poly;
+        poly.allowedInside = t % 2 == 1;
+        seed = seed * 1103515245 + 12345;
+        int k = 5 + (seed >> 16) % 10;
+        for(int i = 0; i < k; i++) {
+            seed = seed * 1103515245 + 12345;
+            double r = 5 + (seed >> 16) % 35;
+            Node node;
+            node.id = i;
+            node.x = 50 + (int)lround(r * cos(2 * M_PI * i / k));
+            node.y = 50 + (int)lround(r * sin(2 * M_PI * i / k));
+            poly.nodes.push_back(node);
+        }
+        poly.numOfNodes = poly.nodes.size();
+        plain.polygons.assign(1, poly);
+        simple.polygons.assign(1, poly);
+        MapNormalizer plainNormalizer(&plain), simpleNormalizer(&simple);
+        plainNormalizer.normalize(0);
+        simpleNormalizer.normalize(3);
+
+        for(int y = 5; y <= 95; y++) {
+            for(int x = 5; x <= 95; x++) {
+                if(plain.isForbidden(x, y) && !simple.isForbidden(x, y)) {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+/* ------------------------------------------------------------------ */
+/* Tests on the socket endpoint */
+bool testSocketBatch() {
+    Map sm;
+    sm.load("route.db");
+    string path = "/tmp/mapserver-test-" + to_string(getpid()) + ".sock";
+    SocketServer server(&sm, path);
+    if(!server.start()) {
+        return false;
+    }
+
+    SocketClient client;
+    if(!client.connect(path)) {
+        return false;
+    }
+    vector<SocketRequest> reqs(3);
+    vector<SocketResponse> res;
+    reqs[0].seq = 7; reqs[0].op = SOCKET_OP_FORBIDDEN_POS; reqs[0].a = 10; reqs[0].b = 10;
+    reqs[1].seq = 8; reqs[1].op = SOCKET_OP_MARKING_POS;   reqs[1].a = 2;  reqs[1].b = 0;
+    reqs[2].seq = 9; reqs[2].op = 42;                      reqs[2].a = 0;  reqs[2].b = 0;
+    bool ok = client.query(reqs, res);
+    client.close();
+    server.stop();
+
+    return ok && res.size() == 3 &&
+           res[0].seq == 7 && res[0].status == SOCKET_STATUS_OK && res[0].a == 1 &&
+           res[1].seq == 8 && res[1].a == 18 && res[1].b == 15 &&
+           res[2].seq == 9 && res[2].status == SOCKET_STATUS_BAD_OP;
+}
+
+bool testSocketLargeBatch() {
+    Map sm;
+    sm.load("route.db");
+    string path = "/tmp/mapserver-test-" + to_string(getpid()) + ".sock";
+    SocketServer server(&sm, path);
+    if(!server.start()) {
+        return false;
+    }
+
+    // several times more than a connection may hold at once
+    SocketClient client;
+    if(!client.connect(path)) {
+        return false;
+    }
+    vector<SocketRequest> reqs(300000);
+    vector<SocketResponse> res;
+    for(int i = 0; i < reqs.size(); i++) {
+        reqs[i].seq = i; reqs[i].op = SOCKET_OP_FORBIDDEN_POS; reqs[i].a = i % 30; reqs[i].b = 10;
+    }
+    bool ok = client.query(reqs, res);
+    client.close();
+    for(int i = 0; ok && i < res.size(); i++) {
+        ok = res[i].seq == i && res[i].a == sm.isForbidden(i % 30, 10);
+    }
+    server.stop();
+    return ok;
+}
+
+bool testSocketAnswersAfterShutdown() {
+    Map sm;
+    sm.load("route.db");
+    string path = "/tmp/mapserver-test-" + to_string(getpid()) + ".sock";
+    SocketServer server(&sm, path);
+    if(!server.start()) {
+        return false;
+    }
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path.c_str());
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(fd < 0 || connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        return false;
+    }
+    // more answers than fit in the socket buffers are still queued when
+    // the client closes its sending side
+    vector<SocketRequest> reqs(300000);
+    for(int i = 0; i < reqs.size(); i++) {
+        reqs[i].seq = i; reqs[i].op = SOCKET_OP_MARKING_POS; reqs[i].a = 2; reqs[i].b = 0;
+    }
+    bool sent = true;
+    thread writer([&sent, &reqs, fd] {
+        const char *out = (const char *)reqs.data();
+        size_t left = reqs.size() * sizeof(SocketRequest);
+        while(sent && left > 0) {
+            ssize_t n = send(fd, out, left, MSG_NOSIGNAL);
+            sent = n > 0;
+            out += sent ? n : 0;
+            left -= sent ? n : 0;
+        }
+        shutdown(fd, SHUT_WR);
+    });
+    bool ok = true;
+    vector<SocketResponse> res(reqs.size());
+    size_t got = 0, want = res.size() * sizeof(SocketResponse);
+    while(ok && got < want) {
+        ssize_t n = recv(fd, (char *)res.data() + got, want - got, 0);
+        ok = n > 0;
+        got += ok ? n : 0;
+    }
+    writer.join();
+    close(fd);
+    server.stop();
+    return ok && sent && res.back().seq == reqs.size() - 1 && res.back().a == 18;
+}
+
+/* ------------------------------------------------------------------ */
+/* Tests on query capture */
+bool testCaptureRingWraps() {
+    string path = "/tmp/mapserver-test-" + to_string(getpid()) + ".cap";
+    QueryLogWriter writer;
+    if(!writer.open(path, 4)) {
+        return false;
+    }
+    for(int i = 0; i < 6; i++) {
+        writer.record(QUERY_FORBIDDEN_POS, i, -i, i % 2, 0, 1000 + i, 10);
+    }
+    writer.close();
+
+    vector<QueryRecord> records;
+    bool ok = readQueryLog(path, records);
+    unlink(path.c_str());
+    if(!ok || records.size() != 4) {
+        return false;
+    }
+    for(int i = 0; i < 4; i++) {
+        QueryRecord &rec = records[i];
+        if(rec.a != i + 2 || rec.b != -(i + 2) || rec.resultA != (i + 2) % 2 ||
+           rec.timeNs != 1002 + i || rec.op != QUERY_FORBIDDEN_POS) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* ------------------------------------------------------------------ */
+/* Tests on shadow verification */
+bool testShadowFindsMismatch() {
+    Map sm;
+    sm.load("route.db");
+    ShadowVerifier shadow(&sm, 1.0, 100, 10);
+    shadow.start();
+    shadow.submit(1, 1, false);
+    shadow.submit(10, 10, true);
+    shadow.submit(15, 15, true);
+    shadow.drain();
+
+    vector<Reproducer> reproducers;
+    shadow.getReproducers(reproducers);
+    shadow.stop();
+    return shadow.checked == 3 && shadow.mismatches == 1 && reproducers.size() == 1 &&
+           reproducers[0].x == 15 && reproducers[0].y == 15 &&
+           reproducers[0].live && !reproducers[0].reference;
+}
+
+bool testShadowSamples() {
+    Map sm;
+    sm.load("route.db");
+    ShadowVerifier shadow(&sm, 0.25, 100, 10);
+    shadow.start();
+    for(int i = 0; i < 20; i++) {
+        shadow.submit(i, 1, sm.isForbidden(i, 1));
+    }
+    shadow.drain();
+    shadow.stop();
+    return shadow.submitted == 20 && shadow.checked == 5 && shadow.mismatches == 0;
+}
+
+/*
+  Every query engine gives the same answer as Map on a grid around the map
+*/
+bool testEnginesMatchMap() {
+    Map em;
+    em.load("route.db");
+    em.load("redundantPoly.db");
+    IndexedEngine indexed(&em);
+    RasterEngine raster(&em);
+    SimdEngine simd(&em);
+    CompactEngine compact(&em);
+    indexed.build();
+    raster.build();
+    simd.build();
+    compact.build();
+    for(int x = -3; x < 25; x++) {
+        for(int y = -3; y < 25; y++) {
+            bool b = em.isForbidden(x, y);
+            if(indexed.isForbidden(x, y) != b || raster.isForbidden(x, y) != b || simd.isForbidden(x, y) != b ||
+               compact.isForbidden(x, y) != b) {
+                return false;
+            }
+        }
+    }
+    // the compact engine answers from the map, which it has compacted
+    return em.polygons.empty() && em.compacted.size() == 5;
+}
+
+/*
+  Edges of a square at +-CROSSING_MAX_COORD have deltas of 2^31, the
+  simd engine and the footprint zones still answer like Map
+*/
+bool testLargeCoordinateEdges() {
+    Map lm;
+    lm.polygons.clear();
+    lm.markings.clear();
+    lm.footprints.clear();
+    struct Polygon square;
+    square.allowedInside = true;
+    int xs[] = {-CROSSING_MAX_COORD, CROSSING_MAX_COORD, CROSSING_MAX_COORD, -CROSSING_MAX_COORD};
+    int ys[] = {-CROSSING_MAX_COORD, -CROSSING_MAX_COORD, CROSSING_MAX_COORD, CROSSING_MAX_COORD};
+    for(int i = 0; i < 4; i++) {
+        struct Node node;
+        node.id = i;
+        node.x = xs[i];
+        node.y = ys[i];
+        square.nodes.push_back(node);
+    }
+    square.numOfNodes = 4;
+    lm.polygons.push_back(square);
+    struct Footprint circle;
+    circle.id = 1;
+    circle.circle = true;
+    circle.radius = 3;
+    circle.halfWidth = circle.halfHeight = 0;
+    lm.footprints.push_back(circle);
+    SimdEngine simd(&lm);
+    simd.build();
+    FootprintZones zones(&lm);
+    zones.build();
+    int px[] = {0, CROSSING_MAX_COORD - 1, 1 - CROSSING_MAX_COORD, 12345, CROSSING_MAX_COORD + 1, 0};
+    int py[] = {0, 7, -7, CROSSING_MAX_COORD - 1, 0, -CROSSING_MAX_COORD - 1};
+    for(int i = 0; i < 6; i++) {
+        if(simd.isForbidden(px[i], py[i]) != lm.isForbidden(px[i], py[i])) {
+            return false;
+        }
+    }
+    bool center = true, edge = false;
+    zones.isFootprintForbidden(0, 0, 1, center);
+    zones.isFootprintForbidden(CROSSING_MAX_COORD - 1, 0, 1, edge);
+    return !lm.isForbidden(0, 0) && !center && edge;
+}
+
+/*
+  Waits until n calls are queued in the scheduler
+*/
+void waitForDepth(Scheduler &sched, int n) {
+    SchedStats stats;
+    do {
+        this_thread::sleep_for(chrono::milliseconds(1));
+        sched.getStats(stats);
+    } while(stats.depth < n);
+}
+
+/*
+  With the only slot taken, queued calls run highest priority first
+*/
+bool testSchedulerPriority() {
+    Scheduler sched(1, 10);
+    mutex orderLock;
+    vector<int> order;
+    sched.admit(0, SCHED_NO_DEADLINE);
+    vector<thread> callers;
+    int priorities[] = {0, 2, 1};
+    for(int i = 0; i < 3; i++) {
+        int priority = priorities[i];
+        callers.push_back(thread([&sched, &orderLock, &order, priority] {
+            if(sched.admit(priority, SCHED_NO_DEADLINE) == SCHED_ADMITTED) {
+                lock_guard<mutex> guard(orderLock);
+                order.push_back(priority);
+                sched.release();
+            }
+        }));
+        waitForDepth(sched, i + 1);
+    }
+    sched.release();
+    for(int i = 0; i < callers.size(); i++) {
+        callers[i].join();
+    }
+    return order.size() == 3 && order[0] == 2 && order[1] == 1 && order[2] == 0;
+}
+
+/*
+  Calls whose deadline passes in the queue are shed, a full queue rejects
+  lower priority calls and evicts for higher priority ones
+*/
+bool testSchedulerShedding() {
+    Scheduler sched(1, 1);
+    bool passed = sched.admit(0, 0) == SCHED_EXPIRED;
+    sched.admit(0, SCHED_NO_DEADLINE);
+    passed = passed && sched.admit(1, 0.01) == SCHED_EXPIRED;
+    int evictedResult = SCHED_ADMITTED;
+    thread low([&sched, &evictedResult] { evictedResult = sched.admit(1, SCHED_NO_DEADLINE); });
+    waitForDepth(sched, 1);
+    passed = passed && sched.admit(0, 0.01) == SCHED_REJECTED;
+    int highResult = SCHED_REJECTED;
+    thread high([&sched, &highResult] {
+        highResult = sched.admit(2, SCHED_NO_DEADLINE);
+        sched.release();
+    });
+    low.join();
+    sched.release();
+    high.join();
+    SchedStats stats;
+    sched.getStats(stats);
+    return passed && evictedResult == SCHED_REJECTED && highResult == SCHED_ADMITTED &&
+           stats.expired == 2 && stats.rejected == 1 && stats.evicted == 1 && stats.busy == 0;
+}
+
+/*
+  Without a scheduler calls are admitted unless their deadline has passed
+*/
+bool testSlotWithoutScheduler() {
+    unsigned long before = SchedSlot::expiredUnscheduled;
+    SchedSlot late(NULL, 0, 0);
+    SchedSlot open(NULL, 0, SCHED_NO_DEADLINE);
+    SchedSlot soon(NULL, 2, 0.5);
+    return late.result == SCHED_EXPIRED && !late.admitted() && open.admitted() && soon.admitted() &&
+           SchedSlot::expiredUnscheduled == before + 1;
+}
+
+/*
+  A compacted map answers like the original one, also with vertices that
+  need multi byte deltas
+*/
+bool testCompactMatchesMap() {
+    Map original;
+    original.load("route.db");
+    original.load("redundantPoly.db");
+    struct Polygon wide;
+    wide.allowedInside = true;
+    int xs[] = {-5000, 5000, 5000, -5000};
+    int ys[] = {-3, -3, 30, 30};
+    for(int i = 0; i < 4; i++) {
+        struct Node node;
+        node.id = i;
+        node.x = xs[i];
+        node.y = ys[i];
+        wide.nodes.push_back(node);
+    }
+    wide.numOfNodes = 4;
+    original.polygons.push_back(wide);
+    Map compacted = original;
+    compacted.compact();
+    if(!compacted.polygons.empty() || compacted.compacted.size() != original.polygons.size()) {
+        return false;
+    }
+    for(int x = -5; x < 25; x++) {
+        for(int y = -5; y < 35; y++) {
+            if(original.isForbidden(x, y) != compacted.isForbidden(x, y)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/*
+  Everything built from a compacted map answers like when it is built from
+  the original one
+*/
+bool testDerivedAfterCompact() {
+    const char *files[] = {"route.db", "footprint.db", "zones.db"};
+    for(int f = 0; f < 3; f++) {
+        Map original;
+        original.load(files[f]);
+        Map compacted = original;
+        compacted.compact();
+        FootprintZones originalFootprints(&original), compactedFootprints(&compacted);
+        ZoneLayer originalZones(&original), compactedZones(&compacted);
+        ForbiddenRaster raster(&compacted, RASTER_MAX_CELLS);
+        IndexedEngine indexed(&compacted);
+        SimdEngine simd(&compacted);
+        RouteGraph originalGraph(&original), compactedGraph(&compacted);
+        originalFootprints.build();
+        compactedFootprints.build();
+        originalZones.build();
+        compactedZones.build();
+        raster.build();
+        indexed.build();
+        simd.build();
+        originalGraph.build();
+        compactedGraph.build();
+        if(!compacted.polygons.empty() || originalGraph.numOfNodes() != compactedGraph.numOfNodes() ||
+           originalGraph.numOfEdges() != compactedGraph.numOfEdges()) {
+            return false;
+        }
+        for(int x = -3; x < 25; x++) {
+            for(int y = -3; y < 25; y++) {
+                bool b = original.isForbidden(x, y);
+                if(raster.isForbidden(x, y) != b || indexed.isForbidden(x, y) != b || simd.isForbidden(x, y) != b) {
+                    return false;
+                }
+                ZoneAttributes a, c;
+                originalZones.query(x, y, a);
+                compactedZones.query(x, y, c);
+                if(a.flags != c.flags || a.speedLimit != c.speedLimit || a.heading != c.heading) {
+                    return false;
+                }
+                for(int i = 0; i < original.footprints.size(); i++) {
+                    bool fa = false, fc = false;
+                    originalFootprints.isFootprintForbidden(x, y, original.footprints[i].id, fa);
+                    compactedFootprints.isFootprintForbidden(x, y, original.footprints[i].id, fc);
+                    if(fa != fc) {
+                        return false;
+                    }
+                }
+            }
+        }
+    }
+    return true;
+}
+
+/*
+  Zones are parsed next to the polygons and don't change isForbidden
+*/
+bool createZones() {
+    Map zm;
+    zm.load("zones.db");
+    Map plain;
+    plain.load("zones.db");
+    plain.zones.clear();
+    if(zm.polygons.size() != 2 || zm.zones.size() != 3) {
+        return false;
+    }
+    if(zm.polygons[0].attributes.flags != 0 || zm.polygons[1].attributes.flags != ZONE_SPEED_LIMIT ||
+       zm.zones[0].attributes.flags != (ZONE_SPEED_LIMIT | ZONE_NO_STOP) || zm.zones[2].attributes.heading != 270) {
+        return false;
+    }
+    for(int x = -2; x < 23; x++) {
+        for(int y = -2; y < 23; y++) {
+            if(zm.isForbidden(x, y) != plain.isForbidden(x, y)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/*
+  One query gives the forbidden bit and the combined attributes
+*/
+bool testZoneQuery() {
+    Map zm;
+    zm.load("zones.db");
+    ZoneLayer layer(&zm);
+    layer.build();
+    ZoneAttributes a;
+    for(int x = -2; x < 23; x++) {
+        for(int y = -2; y < 23; y++) {
+            layer.query(x, y, a);
+            if(((a.flags & ZONE_FORBIDDEN) != 0) != zm.isForbidden(x, y)) {
+                return false;
+            }
+        }
+    }
+    bool passed = true;
+    layer.query(2, 2, a);
+    passed = passed && a.flags == (ZONE_SPEED_LIMIT | ZONE_NO_STOP) && a.speedLimit == 5;
+    layer.query(7, 7, a);
+    passed = passed && a.flags == (ZONE_SPEED_LIMIT | ZONE_NO_STOP | ZONE_ONE_WAY) && a.speedLimit == 3 && a.heading == 90;
+    layer.query(11, 11, a);
+    passed = passed && a.flags == (ZONE_FORBIDDEN | ZONE_SPEED_LIMIT | ZONE_ONE_WAY) && a.speedLimit == 1;
+    layer.query(6, 5, a);
+    passed = passed && (a.flags & ZONE_ONE_WAY) && a.heading == 90;
+    layer.query(2, 5, a);
+    passed = passed && (a.flags & ZONE_ONE_WAY) && a.heading == 270;
+    layer.query(18, 18, a);
+    passed = passed && a.flags == 0;
+    layer.query(30, 30, a);
+    passed = passed && a.flags == ZONE_FORBIDDEN;
+    return passed;
+}
+
+/*
+  The compatibility kernel gives the verdict of the division one on random
+  edges small enough for its int products
+*/
+bool testCrossingCompat() {
+    unsigned int seed = 4711;
+    for(int i = 0; i < 200000; i++) {
+        int v[6];
+        for(int j = 0; j < 6; j++) {
+            seed = seed * 1103515245 + 12345;
+            v[j] = (int)((seed >> 8) % 2001) - 1000;
+        }
+        if(crossesCompat(v[0], v[1], v[2], v[3], v[4], v[5]) != crossesDivision(v[0], v[1], v[2], v[3], v[4], v[5])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+  The exact kernel reports positions on edges and vertices as boundary and
+  classifies the rest by the exact intersection
+*/
+bool testCrossingExact() {
+    Map cm;
+    struct Polygon triangle;
+    int xs[] = {0, 10, 0};
+    int ys[] = {0, 0, 3};
+    for(int i = 0; i < 3; i++) {
+        struct Node node;
+        node.id = i;
+        node.x = xs[i];
+        node.y = ys[i];
+        triangle.nodes.push_back(node);
+    }
+    triangle.numOfNodes = 3;
+    triangle.allowedInside = false;
+    bool passed = true;
+    passed = passed && cm.classifyPosInPoly(&triangle, 0, 0) == CROSSING_BOUNDARY;
+    passed = passed && cm.classifyPosInPoly(&triangle, 5, 0) == CROSSING_BOUNDARY;
+    passed = passed && cm.classifyPosInPoly(&triangle, 0, 2) == CROSSING_BOUNDARY;
+    passed = passed && cm.classifyPosInPoly(&triangle, 2, 1) == CROSSING_INSIDE;
+    passed = passed && cm.classifyPosInPoly(&triangle, 9, 2) == CROSSING_OUTSIDE;
+    // the hypotenuse passes x = 20/3 at y = 1, truncated to 6
+    passed = passed && cm.classifyPosInPoly(&triangle, 6, 1) == CROSSING_INSIDE && !cm.isPosInPoly(&triangle, 6, 1);
+    return passed;
+}
+
+/*
+  Coordinates far beyond what the int products of the division could take
+*/
+bool testCrossingLargeCoordinates() {
+    Map cm;
+    struct Polygon square;
+    int xs[] = {-100000000, 100000000, 100000000, -100000000};
+    int ys[] = {-100000000, -100000000, 100000000, 100000000};
+    for(int i = 0; i < 4; i++) {
+        struct Node node;
+        node.id = i;
+        node.x = xs[i];
+        node.y = ys[i];
+        square.nodes.push_back(node);
+    }
+    square.numOfNodes = 4;
+    square.allowedInside = true;
+    return cm.isPosInPoly(&square, 12345, -6789) && !cm.isPosInPoly(&square, 100000001, 0) &&
+           cm.classifyPosInPoly(&square, 100000000, 5) == CROSSING_BOUNDARY &&
+           cm.classifyPosInPoly(&square, 99999999, 99999999) == CROSSING_INSIDE;
+}
+
 /*
   given two doubles, returns diff < 0.000001
 */
@@ -390,4 +1258,40 @@ int main(int argc, char* argv[]) {
     cout << ((testGoodGet())            ?  "testGoodGet()         assertion holds\n" : "testGoodGet()         assertion failed\n");
     cout << ((testBadGet())             ?  "testBadGet()          assertion holds\n" : "testBadGet()          assertion failed\n");
     cout << ((testMultipleGet())        ?  "testMultipleGet()     assertion holds\n" : "testMultipleGet()     assertion failed\n");
+    cout << ((testRouteAroundWall())    ?  "testRouteAroundWall() assertion holds\n" : "testRouteAroundWall() assertion failed\n");
+    cout << ((testRouteLatticeAllowed()) ?  "testRouteLatticeAllowed() assertion holds\n" : "testRouteLatticeAllowed() assertion failed\n");
+    cout << ((testRouteForbiddenMarking()) ?  "testRouteForbiddenMarking() assertion holds\n" : "testRouteForbiddenMarking() assertion failed\n");
+    cout << ((testRouteCacheInvalidation()) ? "testRouteCacheInvalidation() assertion holds\n" : "testRouteCacheInvalidation() assertion failed\n");
+    cout << ((testRouteGraphWaypoints()) ? "testRouteGraphWaypoints() assertion holds\n" : "testRouteGraphWaypoints() assertion failed\n");
+    cout << ((createFootprints())       ?  "createFootprints()    assertion holds\n" : "createFootprints()    assertion failed\n");
+    cout << ((testFootprintForbidden()) ?  "testFootprintForbidden() assertion holds\n" : "testFootprintForbidden() assertion failed\n");
+    cout << ((testFootprintUnknownClass()) ? "testFootprintUnknownClass() assertion holds\n" : "testFootprintUnknownClass() assertion failed\n");
+    cout << ((testFootprintConcave()) ? "testFootprintConcave() assertion holds\n" : "testFootprintConcave() assertion failed\n");
+    cout << ((testFootprintDeflateVanishingEdge()) ? "testFootprintDeflateVanishingEdge() assertion holds\n" : "testFootprintDeflateVanishingEdge() assertion failed\n");
+    cout << ((testRasterMatchesMap())   ?  "testRasterMatchesMap() assertion holds\n" : "testRasterMatchesMap() assertion failed\n");
+    cout << ((testRegionQuery())        ?  "testRegionQuery()     assertion holds\n" : "testRegionQuery()     assertion failed\n");
+    cout << ((testRegionQueryTooLarge()) ? "testRegionQueryTooLarge() assertion holds\n" : "testRegionQueryTooLarge() assertion failed\n");
+    cout << ((testNormalizeRedundant()) ?  "testNormalizeRedundant() assertion holds\n" : "testNormalizeRedundant() assertion failed\n");
+    cout << ((testNormalizeDegenerate()) ? "testNormalizeDegenerate() assertion holds\n" : "testNormalizeDegenerate() assertion failed\n");
+    cout << ((testNormalizeSelfIntersecting()) ? "testNormalizeSelfIntersecting() assertion holds\n" : "testNormalizeSelfIntersecting() assertion failed\n");
+    cout << ((testSimplifyGrowsForbidden()) ? "testSimplifyGrowsForbidden() assertion holds\n" : "testSimplifyGrowsForbidden() assertion failed\n");
+    cout << ((testSimplifyGrowsForbiddenStars()) ? "testSimplifyGrowsForbiddenStars() assertion holds\n" : "testSimplifyGrowsForbiddenStars() assertion failed\n");
+    cout << ((testSocketBatch())        ?  "testSocketBatch()     assertion holds\n" : "testSocketBatch()     assertion failed\n");
+    cout << ((testSocketLargeBatch())   ?  "testSocketLargeBatch() assertion holds\n" : "testSocketLargeBatch() assertion failed\n");
+    cout << ((testSocketAnswersAfterShutdown()) ? "testSocketAnswersAfterShutdown() assertion holds\n" : "testSocketAnswersAfterShutdown() assertion failed\n");
+    cout << ((testCaptureRingWraps())   ?  "testCaptureRingWraps() assertion holds\n" : "testCaptureRingWraps() assertion failed\n");
+    cout << ((testShadowFindsMismatch()) ? "testShadowFindsMismatch() assertion holds\n" : "testShadowFindsMismatch() assertion failed\n");
+    cout << ((testShadowSamples())      ?  "testShadowSamples()   assertion holds\n" : "testShadowSamples()   assertion failed\n");
+    cout << ((testEnginesMatchMap())    ?  "testEnginesMatchMap() assertion holds\n" : "testEnginesMatchMap() assertion failed\n");
+    cout << ((testLargeCoordinateEdges())  ?  "testLargeCoordinateEdges() assertion holds\n" : "testLargeCoordinateEdges() assertion failed\n");
+    cout << ((testSchedulerPriority())  ?  "testSchedulerPriority() assertion holds\n" : "testSchedulerPriority() assertion failed\n");
+    cout << ((testSchedulerShedding())  ?  "testSchedulerShedding() assertion holds\n" : "testSchedulerShedding() assertion failed\n");
+    cout << ((testSlotWithoutScheduler())  ?  "testSlotWithoutScheduler() assertion holds\n" : "testSlotWithoutScheduler() assertion failed\n");
+    cout << ((testCompactMatchesMap())  ?  "testCompactMatchesMap() assertion holds\n" : "testCompactMatchesMap() assertion failed\n");
+    cout << ((testDerivedAfterCompact())  ?  "testDerivedAfterCompact() assertion holds\n" : "testDerivedAfterCompact() assertion failed\n");
+    cout << ((createZones())            ?  "createZones()         assertion holds\n" : "createZones()         assertion failed\n");
+    cout << ((testZoneQuery())          ?  "testZoneQuery()       assertion holds\n" : "testZoneQuery()       assertion failed\n");
+    cout << ((testCrossingCompat())     ?  "testCrossingCompat()  assertion holds\n" : "testCrossingCompat()  assertion failed\n");
+    cout << ((testCrossingExact())      ?  "testCrossingExact()   assertion holds\n" : "testCrossingExact()   assertion failed\n");
+    cout << ((testCrossingLargeCoordinates()) ? "testCrossingLargeCoordinates() assertion holds\n" : "testCrossingLargeCoordinates() assertion failed\n");
 }